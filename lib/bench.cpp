@@ -0,0 +1,117 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "constant.hpp"
+#include "driver.hpp"
+#include "error.hpp"
+#include "object_cl.hpp"
+#include "statistics.hpp"
+#include "table.hpp"
+#include "testbench.hpp"
+#include "token.hpp"
+
+using namespace CLTestbench;
+
+namespace
+{
+/// Parses an optional trailing count for the 'bench' command.
+uint32_t ParseCount(TokenStream& tokens, uint32_t defaultValue)
+{
+    if (!tokens) return defaultValue;
+    Token token = tokens.consume();
+    if (token.mType != Token::Constant) throw CommandError("Expected constant.", token);
+    return tokens.parseConstant<uint32_t>(token);
+}
+} // namespace
+
+void Testbench::executeBench(TokenStream& tokens)
+{
+    if (!mDriver)
+        throw CommandError("An OpenCL implementation must be loaded for a 'bench' command.");
+
+    // The arguments are bound once, while parsing.
+    Launch launch = parseLaunch(tokens);
+
+    Token iterationsToken = tokens.current();
+    const uint32_t iterations = ParseCount(tokens, 100);
+    if (iterations == 0) throw CommandError("At least one iteration is required.", iterationsToken);
+    const uint32_t warmup = ParseCount(tokens, 10);
+    if (tokens && mOptions.verbose) *mOut << "Trailing tokens on 'bench' command ignored.\n";
+
+    Driver::ProfilingGuard profiling(*mDriver);
+    LaunchTimings timings = timeLaunch(launch, iterations, warmup);
+
+    const Statistics device = ComputeStatistics(std::move(timings.mDevice));
+    const Statistics host = ComputeStatistics(std::move(timings.mHost));
+
+    // The table only holds views, so the formatted text must outlive it.
+    std::vector<std::string> cells;
+    auto printRow = [&](Util::Table& table, unsigned row, std::string_view name, const Statistics& stats) {
+        table[row][0] = name;
+        const double values[] = {stats.mMin, stats.mMedian, stats.mMean, stats.mP95, stats.mP99, stats.mStdDev};
+        unsigned col = 1;
+        for (double value : values) {
+            cells.push_back(FormatNanoseconds(value));
+            table[row][col++] = cells.back();
+        }
+    };
+    cells.reserve(12);
+
+    Util::Table table(7, 2);
+    table.setHeader({"", "Min", "Median", "Mean", "P95", "P99", "StdDev"});
+    printRow(table, 0, "Device", device);
+    printRow(table, 1, "Host", host);
+
+    if (mOptions.verbose) *mOut << iterations << " iterations after " << warmup << " warmup runs:\n";
+    *mOut << table;
+}
+
+Testbench::LaunchTimings Testbench::timeLaunch(const Launch& launch, uint32_t iterations, uint32_t warmup)
+{
+    assert(mDriver && mDriver->isProfiling() && "Device timings require a profiling queue!");
+    auto& kernel = static_cast<KernelObject&>(*launch.mKernel);
+    // The same local size as 'run' would use.
+    const std::optional<Driver::EnqueueSize> local = launch.mLocal ? launch.mLocal : findTunedLocalSize(launch);
+
+    // Don't let previously enqueued work skew the first launches.
+    mDriver->finish();
+
+    LaunchTimings timings;
+    timings.mDevice.reserve(iterations);
+    timings.mHost.reserve(iterations);
+
+    for (uint32_t i = 0; i < warmup + iterations; ++i) {
+        Driver::ProfileEntry entry;
+        const auto hostStart = std::chrono::steady_clock::now();
+        // The timings are reported here, rather than filling the profile of 'stats'.
+        mDriver->enqueueKernel(kernel, launch.mGlobal, local, launch.mOffset, &entry.mEvent, nullptr, {}, false);
+        // This waits for the kernel to finish.
+        mDriver->resolveProfile(entry);
+        const auto hostEnd = std::chrono::steady_clock::now();
+
+        if (i < warmup) continue;
+        timings.mDevice.push_back(entry.mEnd > entry.mStart ? static_cast<double>(entry.mEnd - entry.mStart) : 0.0);
+        timings.mHost.push_back(static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(hostEnd - hostStart).count()));
+    }
+
+    return timings;
+}
@@ -15,6 +15,7 @@
 
 #include "testbench.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 #include "constant.hpp"
@@ -25,6 +26,32 @@
 
 using namespace CLTestbench;
 
+namespace
+{
+/// Binds an argument with 'set', unless the kernel already has the same value bound.
+template<typename SetFn>
+void BindIfChanged(KernelObject& kernel, uint32_t argIndex, BoundKernelArg::Kind kind, const void* value,
+                   std::size_t size, const std::shared_ptr<Object>& object, SetFn&& set)
+{
+    auto& data = kernel.data;
+    if (data.mBound.size() <= argIndex) data.mBound.resize(argIndex + 1);
+    BoundKernelArg& bound = data.mBound[argIndex];
+
+    const auto* bytes = static_cast<const unsigned char*>(value);
+    const bool released = (kind == BoundKernelArg::Memory || kind == BoundKernelArg::SVM) && bound.mObject.expired();
+    if (bound.mKind == kind && !released &&
+        std::equal(bytes, bytes + size, bound.mValue.begin(), bound.mValue.end())) {
+        ++data.mArgSetsSkipped;
+        return;
+    }
+    set();
+    ++data.mArgSetsIssued;
+    bound.mKind = kind;
+    bound.mValue.assign(bytes, bytes + size);
+    bound.mObject = object;
+}
+} // namespace
+
 void Testbench::executeBind(TokenStream& tokens)
 {
     if (!mDriver) throw CommandError("A driver is required for a 'bind' command.");
@@ -46,27 +73,63 @@ void Testbench::executeBind(TokenStream& tokens)
     }
 
     do {
-        Token token = tokens.current();
-        if (token.mType == Token::Constant) {
-            // This is a tricky one because it could be any type.
-            // The only way of knowing is to query the argument type of the
-            // kernel, which isn't implemented at the moment.
-            // The type is required to set the appropriate "size" argument
-            // to clSetKernelArg.
+        bindArgument(*kernel, argIndex++, tokens);
+    } while(tokens);
+}
+
+void Testbench::bindArgument(Object& kernelObj, uint32_t argIndex, TokenStream& tokens)
+{
+    auto& kernel = static_cast<KernelObject&>(kernelObj);
+    Token token = tokens.current();
+    if (token.mType == Token::Constant) {
+        // The type is required to set the appropriate "size" argument to clSetKernelArg.
+        // It is known only if the kernel has argument metadata.
+        tokens.advance();
+        const auto& args = kernel.data.mArgs;
+        if (args.empty()) {
             throw CommandError([&](std::ostream& out){
                 out << "A type is required for a constant argument.  Example:\n"
-                        "  ulong(" << tokens.getTokenText(token) << ')';
+                       "  ulong(" << tokens.getTokenText(token) << ")\n"
+                       "Alternatively, build the program with -cl-kernel-arg-info.";
             }, token);
         }
-        // Anything else we evaluate to a memory object.
-        auto evaluated = evaluate(tokens);
-        if (auto* memObj = dynamic_cast<MemoryObject*>(evaluated.get())) {
-            if (!memObj) throw CommandError("Expected memory object.", token);
-            mDriver->setKernelArg(*kernel, argIndex, *memObj);
-        } else if (auto* dataObj = dynamic_cast<DataObject*>(evaluated.get())) {
-            mDriver->setKernelArg(*kernel, argIndex, dataObj->data(), dataObj->size());
-        } else {
-            throw CommandError("Unsupported kernel argument type.", token);
+        if (argIndex >= args.size()) throw CommandError("Argument index out of range for the kernel.", token);
+
+        const KernelArgInfo& arg = args[argIndex];
+        if (arg.mAddress == CL_KERNEL_ARG_ADDRESS_LOCAL) {
+            // The constant is the size of the local memory.
+            const auto size = tokens.parseConstant<std::size_t>(token);
+            BindIfChanged(kernel, argIndex, BoundKernelArg::Local, &size, sizeof(size), nullptr,
+                          [&] { mDriver->setKernelArg(kernel, argIndex, nullptr, size); });
+            return;
         }
-    } while(tokens);
+        auto value = ParseScalar(tokens, token, arg.mTypeName);
+        if (!value) {
+            throw CommandError([&](std::ostream& out){
+                out << "Cannot convert a constant to argument type '" << arg.mTypeName << "'.";
+            }, token);
+        }
+        BindIfChanged(kernel, argIndex, BoundKernelArg::Value, value->data(), value->size(), nullptr,
+                      [&] { mDriver->setKernelArg(kernel, argIndex, value->data(), value->size()); });
+        return;
+    }
+
+    // Anything else we evaluate to a memory object.
+    auto evaluated = evaluate(tokens);
+    if (auto* memObj = dynamic_cast<MemoryObject*>(evaluated.get())) {
+        // Enqueued just before the kernel, in lazy upload mode.
+        upload(*memObj);
+        const cl_mem mem = *memObj;
+        BindIfChanged(kernel, argIndex, BoundKernelArg::Memory, &mem, sizeof(mem), evaluated,
+                      [&] { mDriver->setKernelArg(kernel, argIndex, mem); });
+    } else if (auto* svmObj = dynamic_cast<SVMObject*>(evaluated.get())) {
+        const void* pointer = svmObj->pointer();
+        BindIfChanged(kernel, argIndex, BoundKernelArg::SVM, &pointer, sizeof(pointer), evaluated,
+                      [&] { mDriver->setKernelArgSVM(kernel, argIndex, pointer); });
+    } else if (auto* dataObj = dynamic_cast<DataObject*>(evaluated.get())) {
+        BindIfChanged(kernel, argIndex, BoundKernelArg::Value, dataObj->data(), dataObj->size(), nullptr,
+                      [&] { mDriver->setKernelArg(kernel, argIndex, dataObj->data(), dataObj->size()); });
+    } else {
+        throw CommandError("Unsupported kernel argument type.", token);
+    }
 }
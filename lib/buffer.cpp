@@ -14,12 +14,20 @@
 // along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
 #include <limits>
 #include <memory>
+#include <new>
+
+#include <unistd.h>
 
 #include "constant.hpp"
 #include "driver.hpp"
 #include "error.hpp"
+#include "istringview.hpp"
 #include "object.hpp"
 #include "object_cl.hpp"
 #include "object_data.hpp"
@@ -28,6 +36,78 @@
 
 using namespace CLTestbench;
 
+namespace
+{
+const std::initializer_list<std::string_view> FlagNames{"use_host", "alloc_host", "read_only", "write_only",
+                                                        "host_no_access"};
+
+bool IsFlag(const TokenStream& tokens, Token token)
+{
+    return token.mType == Token::String && IStringView(tokens.getTokenText(token)).autocomplete(FlagNames) <
+                                                   FlagNames.size();
+}
+
+/// Parses a memory flag word of the 'buffer' function.
+cl_mem_flags ParseFlag(TokenStream& tokens, Token token)
+{
+    if (token.mType != Token::String) throw CommandError("Expected buffer flag.", token);
+
+    switch (IStringView(tokens.getTokenText(token)).autocomplete(FlagNames)) {
+    case 0: return CL_MEM_USE_HOST_PTR;
+    case 1: return CL_MEM_ALLOC_HOST_PTR;
+    case 2: return CL_MEM_READ_ONLY;
+    case 3: return CL_MEM_WRITE_ONLY;
+    case 4: return CL_MEM_HOST_NO_ACCESS;
+    case IStringView::ambiguous: throw CommandError("Ambiguous buffer flag.", token);
+    default: throw CommandError("Unknown buffer flag.", token);
+    }
+}
+
+std::size_t PageSize() { return static_cast<std::size_t>(sysconf(_SC_PAGESIZE)); }
+
+/// Allocates page-aligned host memory for a CL_MEM_USE_HOST_PTR buffer.
+std::shared_ptr<void> AllocatePages(std::size_t size)
+{
+    const std::size_t pageSize = PageSize();
+    // std::aligned_alloc requires the size to be a multiple of the alignment.
+    void* memory = std::aligned_alloc(pageSize, (size + pageSize - 1) / pageSize * pageSize);
+    if (!memory) throw std::bad_alloc();
+    return std::shared_ptr<void>(memory, std::free);
+}
+} // namespace
+
+void Testbench::upload(Object& object)
+{
+    auto& memObj = static_cast<MemoryObject&>(object);
+    if (memObj.data.mParent) return upload(*memObj.data.mParent);
+    if (!memObj.data.mPendingData) return;
+
+    mDriver->streamBuffer(memObj, memObj.data.mPendingData.get(), memObj.data.mBufferSize);
+    // Non-blocking writes read the data after this returns, so it's kept for as long as the buffer.
+    if (mDriver->mBlock) memObj.data.mPendingData.reset();
+    else memObj.data.mHostData = std::move(memObj.data.mPendingData);
+}
+
+void Testbench::checkAllocation(std::size_t size, const Token& token)
+{
+    // Zero limits are unknown.
+    const auto& capabilities = mDriver->getDeviceCapabilities();
+    if (capabilities.mMaxMemAllocSize != 0 && size > capabilities.mMaxMemAllocSize) {
+        throw CommandError([=, max = capabilities.mMaxMemAllocSize](std::ostream& out) {
+            out << "Allocating " << size << " bytes exceeds the device's maximum allocation size of " << max
+                << " bytes.";
+        }, token);
+    }
+    const uint64_t live = mDriver->getMemoryLedger().liveBytes();
+    if (capabilities.mGlobalMemSize != 0 && live + size > capabilities.mGlobalMemSize) {
+        throw CommandError([=, global = capabilities.mGlobalMemSize](std::ostream& out) {
+            out << "Allocating " << size << " bytes, in addition to the " << live
+                << " bytes of live memory objects, exceeds the device's global memory size of " << global
+                << " bytes.  See 'info memory'.";
+        }, token);
+    }
+}
+
 std::shared_ptr<Object> Testbench::evaluateBuffer(TokenStream& tokens)
 {
     // Expect a '('.
@@ -35,11 +115,53 @@ std::shared_ptr<Object> Testbench::evaluateBuffer(TokenStream& tokens)
 
     std::unique_ptr<MemoryObject> buffer;
 
+    // Trailing flag words, such as in buffer(1024, use_host, read_only).
+    cl_mem_flags flags = 0;
+    Token flagsToken;
+    auto parseFlags = [&]() {
+        while (tokens.current().mType == Token::Comma) {
+            tokens.advance();
+            if (!flagsToken) flagsToken = tokens.current();
+            flags |= ParseFlag(tokens, tokens.consume());
+        }
+        if ((flags & CL_MEM_READ_ONLY) && (flags & CL_MEM_WRITE_ONLY))
+            throw CommandError("Buffer flags 'read_only' and 'write_only' are exclusive.", flagsToken);
+        if ((flags & CL_MEM_USE_HOST_PTR) && (flags & CL_MEM_ALLOC_HOST_PTR))
+            throw CommandError("Buffer flags 'use_host' and 'alloc_host' are exclusive.", flagsToken);
+        if (!(flags & (CL_MEM_READ_ONLY | CL_MEM_WRITE_ONLY))) flags |= CL_MEM_READ_WRITE;
+    };
+
     if (tokens.current().mType == Token::Constant) {
         // Expect the single-argument buffer command variant.
-        auto size = tokens.parseConstant<std::size_t>(tokens.current());
-        buffer = mDriver->createBuffer(size);
+        const Token sizeToken = tokens.current();
+        auto size = tokens.parseConstant<std::size_t>(sizeToken);
         tokens.advance();
+
+        // An optional fill pattern, such as in buffer(1024, float(0)).
+        std::shared_ptr<Object> pattern;
+        Token patternToken;
+        if (tokens.current().mType == Token::Comma) {
+            tokens.advance();
+            patternToken = tokens.current();
+            if (IsFlag(tokens, patternToken)) {
+                flagsToken = patternToken;
+                flags = ParseFlag(tokens, tokens.consume());
+            } else {
+                pattern = evaluate(tokens);
+            }
+        }
+        parseFlags();
+        checkAllocation(size, sizeToken);
+
+        if (flags & CL_MEM_USE_HOST_PTR) {
+            std::shared_ptr<void> memory = AllocatePages(size);
+            std::memset(memory.get(), 0, size);
+            buffer = mDriver->createBuffer(size, flags, memory.get());
+            buffer->data.mHostData = std::move(memory);
+        } else {
+            buffer = mDriver->createBuffer(size, flags);
+        }
+        if (pattern) fill(*buffer, *pattern, patternToken, 0, size);
     } else {
         Token objectToken = tokens.current();
         // Expect a data object as the first argument.
@@ -55,27 +177,62 @@ std::shared_ptr<Object> Testbench::evaluateBuffer(TokenStream& tokens)
         if (tokens.current().mType == Token::Comma) {
             tokens.advance();
             Token sizeToken = tokens.consume();
-            if (sizeToken.mType != Token::Constant)
-                throw CommandError("Expected start offset constant.", sizeToken);
-            start = tokens.parseConstant<std::size_t>(sizeToken);
-            if (start > data->size())
-                throw CommandError("Size argument exceeds data size.", sizeToken);
-
-            // Check for a length value.
-            if (tokens.current().mType == Token::Comma) {
-                tokens.advance();
-                Token lenToken = tokens.consume();
-                if (lenToken.mType != Token::Constant)
-                    throw CommandError("Expected length constant.", lenToken);
-                len = tokens.parseConstant<std::size_t>(lenToken);
-
-                if ((start + len) > data->size())
-                    throw CommandError("Length argument exceeds data size.", lenToken);
+            if (sizeToken.mType == Token::String) {
+                // No offset given, only flags.
+                flagsToken = sizeToken;
+                flags = ParseFlag(tokens, sizeToken);
+            } else {
+                if (sizeToken.mType != Token::Constant)
+                    throw CommandError("Expected start offset constant.", sizeToken);
+                start = tokens.parseConstant<std::size_t>(sizeToken);
+                if (start > data->size())
+                    throw CommandError("Size argument exceeds data size.", sizeToken);
+                len = data->size() - start;
+
+                // Check for a length value.
+                if (tokens.current().mType == Token::Comma) {
+                    tokens.advance();
+                    Token lenToken = tokens.consume();
+                    if (lenToken.mType == Token::String) {
+                        flagsToken = lenToken;
+                        flags = ParseFlag(tokens, lenToken);
+                    } else {
+                        if (lenToken.mType != Token::Constant)
+                            throw CommandError("Expected length constant.", lenToken);
+                        len = tokens.parseConstant<std::size_t>(lenToken);
+
+                        if ((start + len) > data->size())
+                            throw CommandError("Length argument exceeds data size.", lenToken);
+                    }
+                }
             }
         }
+        parseFlags();
+        checkAllocation(len, objectToken);
 
-        buffer = mDriver->createBuffer(len);
-        mDriver->writeBuffer(*buffer, data->data(), start, len);
+        const char* source = static_cast<const char*>(data->data()) + start;
+        if (flags & CL_MEM_USE_HOST_PTR) {
+            // Wrap the data itself when suitably aligned, so that nothing is copied.  The data object
+            // then aliases the buffer contents, and is kept alive for as long as the buffer.
+            std::shared_ptr<const void> memory(evaluated, source);
+            if (reinterpret_cast<std::uintptr_t>(source) % PageSize() != 0) {
+                if (mOptions.verbose) *mOut << "Data is not page-aligned; the buffer wraps an aligned copy.\n";
+                std::shared_ptr<void> copy = AllocatePages(len);
+                std::memcpy(copy.get(), source, len);
+                memory = std::move(copy);
+            }
+            buffer = mDriver->createBuffer(len, flags, const_cast<void*>(memory.get()));
+            buffer->data.mHostData = std::move(memory);
+        } else if (flags & CL_MEM_HOST_NO_ACCESS) {
+            // The host may not write to the buffer once it's created.
+            buffer = mDriver->createBuffer(len, flags | CL_MEM_COPY_HOST_PTR, const_cast<char*>(source));
+        } else {
+            buffer = mDriver->createBuffer(len, flags);
+            // The data is written directly from the data object, such as a file mapping, without a copy.
+            std::shared_ptr<const void> pending(evaluated, source);
+            if (mOptions.lazyUpload) buffer->data.mPendingData = std::move(pending);
+            else mDriver->streamBuffer(*buffer, source, len);
+        }
     }
 
     // Expect a ')'.  Failing at this point might be excessive because we've already created
@@ -0,0 +1,144 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+
+#include "bufferpool.hpp"
+
+using namespace CLTestbench;
+
+BufferPool::Lease::~Lease()
+{
+    if (!mReleaseFn) return;
+    if (auto pool = mPool.lock()) {
+        pool->giveBack(*this);
+    } else {
+        mReleaseFn(mBuffer);
+    }
+}
+
+BufferPool::~BufferPool() { drain(); }
+
+std::size_t BufferPool::SizeClass(std::size_t size) noexcept
+{
+    // Small buffers share a single class.
+    constexpr std::size_t MinClass = 256;
+    if (size <= MinClass) return MinClass;
+    std::size_t power = MinClass;
+    while (power * 2 < size) power *= 2;
+    // The classes between this power of two and the next.
+    const std::size_t step = power / 4;
+    const std::size_t rounded = (size + step - 1) / step * step;
+    return rounded < size ? size : rounded;
+}
+
+void BufferPool::setLimit(std::size_t bytes)
+{
+    std::lock_guard lock(mMutex);
+    mLimit = bytes;
+    evict(0);
+}
+
+std::size_t BufferPool::getLimit() const noexcept
+{
+    std::lock_guard lock(mMutex);
+    return mLimit;
+}
+
+BufferPool::Lease BufferPool::acquire(std::size_t size, cl_mem_flags flags)
+{
+    std::lock_guard lock(mMutex);
+    // Prefer the most recently used buffer, which is most likely still resident.
+    auto match = std::find_if(mIdle.rbegin(), mIdle.rend(),
+                              [&](const Idle& idle) { return idle.mSize == size && idle.mFlags == flags; });
+    if (match == mIdle.rend()) {
+        ++mStats.mMisses;
+        return {};
+    }
+    ++mStats.mHits;
+    const Idle idle = *match;
+    mIdle.erase(std::next(match).base());
+    mIdleBytes -= idle.mSize;
+    return makeLease(idle.mBuffer, idle.mSize, idle.mFlags);
+}
+
+BufferPool::Lease BufferPool::adopt(cl_mem buffer, std::size_t size, cl_mem_flags flags)
+{
+    std::lock_guard lock(mMutex);
+    return makeLease(buffer, size, flags);
+}
+
+BufferPool::Lease BufferPool::makeLease(cl_mem buffer, std::size_t size, cl_mem_flags flags)
+{
+    Lease lease;
+    lease.mPool = weak_from_this();
+    lease.mBuffer = buffer;
+    lease.mSize = size;
+    lease.mFlags = flags;
+    lease.mGeneration = mGeneration;
+    lease.mReleaseFn = mReleaseFn;
+    return lease;
+}
+
+void BufferPool::giveBack(Lease& lease) noexcept
+{
+    std::lock_guard lock(mMutex);
+    if (lease.mGeneration != mGeneration || lease.mSize > mLimit) {
+        mReleaseFn(lease.mBuffer);
+        return;
+    }
+    evict(lease.mSize);
+    mIdle.push_back({lease.mBuffer, lease.mSize, lease.mFlags});
+    mIdleBytes += lease.mSize;
+}
+
+void BufferPool::evict(std::size_t bytes) noexcept
+{
+    std::size_t count = 0;
+    while (count < mIdle.size() && mIdleBytes + bytes > mLimit) {
+        mReleaseFn(mIdle[count].mBuffer);
+        mIdleBytes -= mIdle[count].mSize;
+        ++mStats.mEvictions;
+        ++count;
+    }
+    mIdle.erase(mIdle.begin(), mIdle.begin() + count);
+}
+
+void BufferPool::drain() noexcept
+{
+    std::lock_guard lock(mMutex);
+    for (const Idle& idle : mIdle) mReleaseFn(idle.mBuffer);
+    mIdle.clear();
+    mIdleBytes = 0;
+    ++mGeneration;
+}
+
+BufferPool::Stats BufferPool::getStats() const noexcept
+{
+    std::lock_guard lock(mMutex);
+    return mStats;
+}
+
+std::size_t BufferPool::getIdleBytes() const noexcept
+{
+    std::lock_guard lock(mMutex);
+    return mIdleBytes;
+}
+
+std::size_t BufferPool::getIdleCount() const noexcept
+{
+    std::lock_guard lock(mMutex);
+    return mIdle.size();
+}
@@ -0,0 +1,129 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <CL/cl.h>
+
+namespace CLTestbench
+{
+/// Recycles released buffers, so that allocating the same sizes again skips clCreateBuffer.
+/// Pooled buffers are allocated with the size rounded up to its size class, so that any
+/// request in the class can reuse them, and are only reused with the same flags.
+class BufferPool final : public std::enable_shared_from_this<BufferPool>
+{
+public:
+    using ReleaseFnTy = cl_int (*)(cl_mem);
+
+    /// Owns the reference to a pooled buffer, and hands the buffer back to the pool when destroyed.
+    /// If the pool is gone, disabled or full by then, the buffer is released instead.
+    class Lease final
+    {
+        std::weak_ptr<BufferPool> mPool;
+        cl_mem mBuffer = nullptr;
+        std::size_t mSize = 0;
+        cl_mem_flags mFlags = 0;
+        uint64_t mGeneration = 0;
+        ReleaseFnTy mReleaseFn = nullptr;
+
+        friend class BufferPool;
+
+    public:
+        Lease() noexcept = default;
+        Lease(Lease&& other) noexcept { *this = std::move(other); }
+        Lease& operator=(Lease&& other) noexcept
+        {
+            std::swap(mPool, other.mPool);
+            std::swap(mBuffer, other.mBuffer);
+            std::swap(mSize, other.mSize);
+            std::swap(mFlags, other.mFlags);
+            std::swap(mGeneration, other.mGeneration);
+            std::swap(mReleaseFn, other.mReleaseFn);
+            return *this;
+        }
+        ~Lease();
+
+        /// Whether a buffer is leased.
+        explicit operator bool() const noexcept { return mReleaseFn != nullptr; }
+        cl_mem get() const noexcept { return mBuffer; }
+    };
+
+    struct Stats
+    {
+        /// Allocations served by an idle buffer, and those which created one.
+        uint64_t mHits = 0;
+        uint64_t mMisses = 0;
+        /// Buffers released to keep the idle buffers under the limit.
+        uint64_t mEvictions = 0;
+    };
+
+    explicit BufferPool(ReleaseFnTy releaseFn) noexcept : mReleaseFn(releaseFn) {}
+    ~BufferPool();
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /// Rounds the size up to its size class.  There are four classes per power of two, so at
+    /// most a fifth of a pooled buffer is unused.
+    static std::size_t SizeClass(std::size_t) noexcept;
+
+    /// The most bytes kept by idle buffers.  Zero disables the pool, releasing the idle buffers.
+    void setLimit(std::size_t bytes);
+    std::size_t getLimit() const noexcept;
+    bool isEnabled() const noexcept { return getLimit() != 0; }
+
+    /// Takes an idle buffer of this size class and flags, or returns an empty lease on a miss.
+    Lease acquire(std::size_t size, cl_mem_flags);
+    /// Leases a buffer just created for a miss, of this size class and flags.  The lease takes
+    /// over the caller's reference.
+    Lease adopt(cl_mem, std::size_t size, cl_mem_flags);
+    /// Releases the idle buffers.  Buffers leased before then are released when handed back,
+    /// as they may belong to a context which is gone.
+    void drain() noexcept;
+
+    Stats getStats() const noexcept;
+    std::size_t getIdleBytes() const noexcept;
+    std::size_t getIdleCount() const noexcept;
+
+private:
+    struct Idle
+    {
+        cl_mem mBuffer;
+        std::size_t mSize;
+        cl_mem_flags mFlags;
+    };
+
+    const ReleaseFnTy mReleaseFn;
+    /// Leases may be destroyed on worker threads.
+    mutable std::mutex mMutex;
+    /// Idle buffers, from the least recently handed back.
+    std::vector<Idle> mIdle;
+    std::size_t mIdleBytes = 0;
+    std::size_t mLimit = 0;
+    /// Changed by drain(), so that buffers leased before can't return.
+    uint64_t mGeneration = 0;
+    Stats mStats;
+
+    Lease makeLease(cl_mem, std::size_t size, cl_mem_flags);
+    void giveBack(Lease&) noexcept;
+    /// Releases the least recently used idle buffers, until adding these bytes keeps to the limit.
+    void evict(std::size_t bytes) noexcept;
+};
+} // namespace CLTestbench
@@ -0,0 +1,32 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+
+#include "cache.hpp"
+
+using namespace CLTestbench;
+
+std::filesystem::path CLTestbench::CacheDirectory()
+{
+    // Empty values must be treated as unset, as per the XDG specification.
+    const char* cacheHome = std::getenv("XDG_CACHE_HOME");
+    if (cacheHome && *cacheHome) return std::filesystem::path(cacheHome) / "cltb";
+
+    const char* home = std::getenv("HOME");
+    if (home && *home) return std::filesystem::path(home) / ".cache" / "cltb";
+
+    return {};
+}
@@ -0,0 +1,70 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <iomanip>
+#include <ostream>
+
+#include "chrometrace.hpp"
+
+using namespace CLTestbench;
+
+namespace
+{
+void WriteJSONString(std::ostream& out, const std::string& text)
+{
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+        else out << c;
+    }
+    out << '"';
+}
+
+/// Trace timestamps are in microseconds.
+void WriteMicroseconds(std::ostream& out, uint64_t nanoseconds)
+{
+    out << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0') << nanoseconds % 1000;
+}
+} // namespace
+
+void CLTestbench::WriteChromeTrace(std::ostream& out, const std::vector<TraceEvent>& events,
+                                   const std::vector<std::string>& trackNames)
+{
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+    bool first = true;
+    for (std::size_t track = 0; track < trackNames.size(); ++track) {
+        if (!first) out << ",\n";
+        first = false;
+        out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << track
+            << ", \"args\": {\"name\": ";
+        WriteJSONString(out, trackNames[track]);
+        out << "}}";
+    }
+    for (const TraceEvent& event : events) {
+        if (!first) out << ",\n";
+        first = false;
+        out << "{\"name\": ";
+        WriteJSONString(out, event.mName);
+        out << ", \"cat\": ";
+        WriteJSONString(out, event.mCategory);
+        out << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.mTrack << ", \"ts\": ";
+        WriteMicroseconds(out, event.mStart);
+        out << ", \"dur\": ";
+        WriteMicroseconds(out, event.mDuration);
+        out << '}';
+    }
+    out << "\n]}\n";
+}
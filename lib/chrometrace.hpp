@@ -0,0 +1,38 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace CLTestbench
+{
+/// A complete event on a timeline track.  Times are in nanoseconds.
+struct TraceEvent
+{
+    std::string mName;
+    std::string mCategory;
+    uint32_t mTrack = 0;
+    uint64_t mStart = 0;
+    uint64_t mDuration = 0;
+};
+
+/// Writes the events in the Chrome Trace Event format, which chrome://tracing and Perfetto load.
+/// Tracks are numbered from zero, and named by trackNames.
+void WriteChromeTrace(std::ostream&, const std::vector<TraceEvent>& events,
+                      const std::vector<std::string>& trackNames);
+} // namespace CLTestbench
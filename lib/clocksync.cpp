@@ -0,0 +1,71 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "clocksync.hpp"
+
+using namespace CLTestbench;
+
+void ClockSync::addSample(ClockPair sample)
+{
+    if (mSamples.size() == MaxSamples) mSamples.erase(mSamples.begin());
+    mSamples.push_back(sample);
+    fit();
+}
+
+void ClockSync::fit() noexcept
+{
+    // Coordinates relative to the first sample keep the doubles precise.
+    const ClockPair& origin = mSamples.front();
+    const double count = static_cast<double>(mSamples.size());
+    double meanX = 0.0, meanY = 0.0;
+    for (const ClockPair& sample : mSamples) {
+        meanX += static_cast<double>(static_cast<int64_t>(sample.mDevice - origin.mDevice));
+        meanY += static_cast<double>(sample.mHost - origin.mHost);
+    }
+    meanX /= count;
+    meanY /= count;
+
+    double covariance = 0.0, variance = 0.0;
+    for (const ClockPair& sample : mSamples) {
+        const double x = static_cast<double>(static_cast<int64_t>(sample.mDevice - origin.mDevice)) - meanX;
+        const double y = static_cast<double>(sample.mHost - origin.mHost) - meanY;
+        covariance += x * y;
+        variance += x * x;
+    }
+    // Readings less than a millisecond apart can't tell drift from read latency.
+    constexpr double MinSpread = 1e6;
+    mSlope = variance > MinSpread * MinSpread ? covariance / variance : 1.0;
+    mIntercept = meanY - mSlope * meanX;
+}
+
+int64_t ClockSync::toHost(uint64_t device) const noexcept
+{
+    const ClockPair& origin = mSamples.front();
+    const double x = static_cast<double>(static_cast<int64_t>(device - origin.mDevice));
+    return origin.mHost + static_cast<int64_t>(std::llround(mIntercept + mSlope * x));
+}
+
+int64_t CLTestbench::EstimateDeviceToHostOffset(const std::vector<ClockPair>& pairs)
+{
+    if (pairs.empty()) return 0;
+    int64_t offset = std::numeric_limits<int64_t>::max();
+    for (const ClockPair& pair : pairs)
+        offset = std::min(offset, pair.mHost - static_cast<int64_t>(pair.mDevice));
+    return offset;
+}
@@ -0,0 +1,61 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace CLTestbench
+{
+/// A device timestamp paired with a host time, both in nanoseconds.
+struct ClockPair
+{
+    int64_t mHost = 0;
+    uint64_t mDevice = 0;
+};
+
+/// Maps device timestamps onto host time, from readings of both clocks taken at the same moment.
+/// With readings spread over time, a least-squares fit compensates for the clocks drifting apart.
+class ClockSync
+{
+public:
+    /// Readings kept for the fit.  Older readings are dropped.
+    static constexpr std::size_t MaxSamples = 64;
+
+    void addSample(ClockPair);
+    bool empty() const noexcept { return mSamples.empty(); }
+    std::size_t size() const noexcept { return mSamples.size(); }
+
+    /// The host time of a device timestamp.  There must be at least one sample.
+    int64_t toHost(uint64_t device) const noexcept;
+    /// How much faster the host clock runs than the device clock, in parts per million.
+    double driftPPM() const noexcept { return (mSlope - 1.0) * 1e6; }
+
+private:
+    std::vector<ClockPair> mSamples;
+    /// host = first host + mIntercept + mSlope * (device - first device)
+    double mSlope = 1.0;
+    double mIntercept = 0.0;
+
+    void fit() noexcept;
+};
+
+/// Estimates the offset to add to device timestamps to get host times, from the host times at
+/// which commands were enqueued and their device queued timestamps.  A command can't be queued
+/// before it is enqueued, so the smallest difference is the closest.  This is the fallback
+/// when the clocks can't be read together.
+int64_t EstimateDeviceToHostOffset(const std::vector<ClockPair>&);
+} // namespace CLTestbench
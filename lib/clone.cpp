@@ -45,6 +45,7 @@ std::shared_ptr<Object> Testbench::evaluateClone(TokenStream& tokens)
     if (auto* memObj = dynamic_cast<MemoryObject*>(object.get())) {
         assert(mDriver && "How do we have a CL object without a driver?");
         // This may be an image or memory buffer.
+        checkAllocation(memObj->data.mBufferSize, objectToken);
         std::unique_ptr<MemoryObject> clone;
         if (memObj->data.mDescriptor.image_width != 0) {
             clone = mDriver->createImage(memObj->data.mFormat, memObj->data.mDescriptor);
@@ -59,13 +60,30 @@ std::shared_ptr<Object> Testbench::evaluateClone(TokenStream& tokens)
             }
             mDriver->copyImage(*memObj, *clone, {}, {}, region);
         } else {
-            clone = mDriver->createBuffer(memObj->data.mBufferSize);
-            mDriver->copyBuffer(*memObj, *clone, 0, 0, memObj->data.mBufferSize);
+            // The clone keeps the access flags, but not the host memory.
+            const cl_mem_flags hostFlags = CL_MEM_USE_HOST_PTR | CL_MEM_COPY_HOST_PTR;
+            clone = mDriver->createBuffer(memObj->data.mBufferSize, memObj->data.mFlags & ~hostFlags);
+            if (memObj->data.mPendingData) {
+                // Neither buffer has its data yet, so the clone uploads it too when first used.
+                clone->data.mPendingData = memObj->data.mPendingData;
+            } else {
+                upload(*memObj);
+                mDriver->copyBuffer(*memObj, *clone, 0, 0, memObj->data.mBufferSize);
+            }
         }
         return clone;
+    } else if (auto* svmObj = dynamic_cast<SVMObject*>(object.get())) {
+        assert(mDriver && "How do we have an SVM allocation without a driver?");
+        auto clone = mDriver->allocateSVM(svmObj->mSize, svmObj->mFlags);
+        mDriver->copySVM(clone->pointer(), svmObj->pointer(), svmObj->mSize);
+        return clone;
     } else if (auto* kernelObj = dynamic_cast<KernelObject*>(object.get())) {
         assert(mDriver && "How do we have a CL object without a driver?");
-        return mDriver->cloneKernel(*kernelObj);
+        auto clone = mDriver->cloneKernel(*kernelObj);
+        clone->data.mName = kernelObj->data.mName;
+        // clCloneKernel copies the bound arguments as well.
+        clone->data.mBound = kernelObj->data.mBound;
+        return clone;
     }
 
     throw CommandError("Cannot clone given object", objectToken);
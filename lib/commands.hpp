@@ -25,7 +25,8 @@ const std::initializer_list<std::string_view> CommandList {
     "load", "select", "info", "list", "set",
     "release", "save", "run", "script",
     "wait", "flush", "bind",
-    "help", "quit"
+    "help", "quit", "stats", "bench", "tune",
+    "fill", "migrate", "rerun", "trace", "jobs"
 };
 namespace Command
 {
@@ -43,6 +44,14 @@ constexpr std::size_t Flush = 10;
 constexpr std::size_t Bind = 11;
 constexpr std::size_t Help = 12;
 constexpr std::size_t Quit = 13;
+constexpr std::size_t Stats = 14;
+constexpr std::size_t Bench = 15;
+constexpr std::size_t Tune = 16;
+constexpr std::size_t Fill = 17;
+constexpr std::size_t Migrate = 18;
+constexpr std::size_t Rerun = 19;
+constexpr std::size_t Trace = 20;
+constexpr std::size_t Jobs = 21;
 
 } // namespace command
 } // namespace CLTestbench
@@ -13,8 +13,14 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <system_error>
 
 #include "driver.hpp"
 #include "object_cl.hpp"
@@ -68,6 +74,10 @@ Driver::Driver(std::string_view filename) : mLib(filename), mCLFns{}
 
 Driver::~Driver()
 {
+    for (auto& build : mBuilds) build.wait();
+    for (ProfileEntry& entry : mTraceEntries) {
+        if (entry.mEvent) mCLFns.clReleaseEvent(entry.mEvent);
+    }
     clearContext();
 }
 
@@ -80,11 +90,16 @@ const char* Driver::Error::what() const noexcept
     case CL_MEM_OBJECT_ALLOCATION_FAILURE: return "Memory object allocation failure";
     case CL_OUT_OF_RESOURCES: return "Out of resources";
     case CL_OUT_OF_HOST_MEMORY: return "Out of host memory";
+    case CL_PROFILING_INFO_NOT_AVAILABLE: return "Profiling information not available";
     case CL_IMAGE_FORMAT_MISMATCH: return "Image format mismatch";
     case CL_IMAGE_FORMAT_NOT_SUPPORTED: return "Image format not supported";
     case CL_BUILD_PROGRAM_FAILURE: return "Program build failure";
+    case CL_MAP_FAILURE: return "Map failure";
+    case CL_KERNEL_ARG_INFO_NOT_AVAILABLE: return "Kernel argument information not available";
     case CL_INVALID_VALUE: return "Invalid value";
     case CL_INVALID_DEVICE: return "Invalid device";
+    case CL_INVALID_QUEUE_PROPERTIES: return "Invalid queue properties";
+    case CL_INVALID_HOST_PTR: return "Invalid host pointer";
     case CL_INVALID_MEM_OBJECT: return "Invalid memory object";
     case CL_INVALID_BINARY: return "Invalid binary";
     case CL_INVALID_BUILD_OPTIONS: return "Invalid build options";
@@ -94,8 +109,13 @@ const char* Driver::Error::what() const noexcept
     case CL_INVALID_ARG_SIZE: return "Invalid kernela argument size";
     case CL_INVALID_KERNEL_ARGS: return "Invalid kernel argument";
     case CL_INVALID_BUFFER_SIZE: return "Invalid buffer size";
+    case CL_INVALID_WORK_GROUP_SIZE: return "Invalid work-group size";
     case CL_INVALID_GLOBAL_WORK_SIZE: return "Invalid global size";
     case CL_INVALID_IMAGE_DESCRIPTOR: return "Invalid image descriptor";
+    case CL_INVALID_EVENT_WAIT_LIST: return "Invalid event wait list";
+    case CL_INVALID_EVENT: return "Invalid event";
+    case CL_MISALIGNED_SUB_BUFFER_OFFSET: return "Misaligned sub-buffer offset";
+    case CL_INVALID_OPERATION: return "Invalid operation";
     default: break;
     }
 
@@ -111,14 +131,182 @@ std::ostream& CLTestbench::operator<<(std::ostream& out, const Driver::PlatformI
 
 std::ostream& CLTestbench::operator<<(std::ostream& out, const Driver::DeviceInfo& info)
 {
-    out << "{\n\tName: " << info.mName << "\n\tVersion: " << info.mVersion << "\n}";
+    out << "{\n\tName: " << info.mName << "\n\tVersion: " << info.mVersion
+        << "\n\tDriver version: " << info.mDriverVersion << "\n}";
+    return out;
+}
+
+namespace
+{
+std::string_view DeviceTypeName(cl_device_type type)
+{
+    if (type & CL_DEVICE_TYPE_GPU) return "GPU";
+    if (type & CL_DEVICE_TYPE_CPU) return "CPU";
+    if (type & CL_DEVICE_TYPE_ACCELERATOR) return "accelerator";
+    return "other";
+}
+
+/// Writes the text as a JSON string.
+void WriteJSONString(std::ostream& out, std::string_view text)
+{
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+        else out << c;
+    }
+    out << '"';
+}
+
+/// The release function of memory objects whose reference is owned by a buffer pool lease.
+cl_int KeepReference(cl_mem) { return CL_SUCCESS; }
+} // namespace
+
+/// Pinned buffers, kept mapped, which the chunks of a streamed transfer go through.  Buffers
+/// allocated by the implementation are pinned, so transfers from them aren't staged again.
+/// Transfers still using them, and consumers of the chunks they hold, are waited for before
+/// they are released.
+class Driver::StagingBuffers final
+{
+    const cl_icd_dispatch& mCLFns;
+    const cl_context mContext;
+    const cl_command_queue mQueue;
+    const std::size_t mChunkSize;
+    std::vector<cl_mem> mBuffers;
+    std::vector<void*> mMapped;
+    std::vector<cl_event> mTransfers;
+    std::vector<std::future<void>> mConsumed;
+
+public:
+    /// The driver must have bound the functions used; see bindStagingFns.
+    StagingBuffers(Driver& driver, cl_command_queue queue, std::size_t count, std::size_t chunkSize) :
+        mCLFns(driver.mCLFns), mContext(driver), mQueue(queue), mChunkSize(chunkSize), mBuffers(count),
+        mMapped(count), mTransfers(count), mConsumed(count)
+    {}
+    StagingBuffers(const StagingBuffers&) = delete;
+    StagingBuffers& operator=(const StagingBuffers&) = delete;
+    ~StagingBuffers() { release(); }
+
+    /// Creates and maps the buffers, returning false if the implementation can't.
+    bool allocate() noexcept
+    {
+        for (std::size_t i = 0; i < mBuffers.size(); ++i) {
+            cl_int err = CL_SUCCESS;
+            mBuffers[i] = mCLFns.clCreateBuffer(mContext, CL_MEM_ALLOC_HOST_PTR, mChunkSize, nullptr, &err);
+            if (err != CL_SUCCESS) return false;
+            mMapped[i] = mCLFns.clEnqueueMapBuffer(mQueue, mBuffers[i], CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 0,
+                                                   mChunkSize, 0, nullptr, nullptr, &err);
+            if (err != CL_SUCCESS) return false;
+        }
+        return true;
+    }
+
+    void release() noexcept
+    {
+        for (std::size_t i = 0; i < mBuffers.size(); ++i) {
+            if (mTransfers[i]) {
+                mCLFns.clWaitForEvents(1, &mTransfers[i]);
+                mCLFns.clReleaseEvent(mTransfers[i]);
+                mTransfers[i] = nullptr;
+            }
+            if (mConsumed[i].valid()) mConsumed[i].wait();
+            if (mMapped[i]) mCLFns.clEnqueueUnmapMemObject(mQueue, mBuffers[i], mMapped[i], 0, nullptr, nullptr);
+            if (mBuffers[i]) mCLFns.clReleaseMemObject(mBuffers[i]);
+            mMapped[i] = nullptr;
+            mBuffers[i] = nullptr;
+        }
+    }
+
+    std::size_t size() const noexcept { return mBuffers.size(); }
+    void* mapped(std::size_t i) const noexcept { return mMapped[i]; }
+
+    /// Takes ownership of the event of the transfer using a buffer.
+    void setTransfer(std::size_t i, cl_event event) noexcept { mTransfers[i] = event; }
+    /// Waits for the transfer using a buffer.
+    void wait(std::size_t i)
+    {
+        if (!mTransfers[i]) return;
+        const cl_int err = mCLFns.clWaitForEvents(1, &mTransfers[i]);
+        mCLFns.clReleaseEvent(mTransfers[i]);
+        mTransfers[i] = nullptr;
+        if (err != CL_SUCCESS) throw Driver::Error(err);
+    }
+
+    void setConsumed(std::size_t i, std::future<void> consumed) noexcept { mConsumed[i] = std::move(consumed); }
+    /// Waits for the chunk in a buffer to be consumed, rethrowing any error of the consumer.
+    void waitConsumed(std::size_t i)
+    {
+        if (mConsumed[i].valid()) mConsumed[i].get();
+    }
+};
+
+std::ostream& CLTestbench::operator<<(std::ostream& out, const Driver::DeviceCapabilities& caps)
+{
+    const auto& widths = caps.mPreferredVectorWidths;
+    out << "{\n\tName: " << caps.mName << "\n\tVendor: " << caps.mVendor << "\n\tVersion: " << caps.mVersion
+        << "\n\tDriver version: " << caps.mDriverVersion << "\n\tType: " << DeviceTypeName(caps.mType)
+        << "\n\tCompute units: " << caps.mComputeUnits << "\n\tMax clock frequency: " << caps.mMaxClockFrequency
+        << " MHz\n\tMax work-group size: " << caps.mMaxWorkGroupSize << "\n\tMax work-item sizes: "
+        << caps.mMaxWorkItemSizes[0] << ", " << caps.mMaxWorkItemSizes[1] << ", " << caps.mMaxWorkItemSizes[2]
+        << "\n\tGlobal memory: " << caps.mGlobalMemSize << " bytes\n\tMax allocation: " << caps.mMaxMemAllocSize
+        << " bytes\n\tGlobal memory cache: " << caps.mGlobalMemCacheSize << " bytes, "
+        << caps.mGlobalMemCacheLineSize << " byte lines\n\tLocal memory: " << caps.mLocalMemSize
+        << " bytes\n\tMax constant buffer: " << caps.mMaxConstantBufferSize
+        << " bytes\n\tBase address alignment: " << caps.mBaseAddressAlignment
+        << " bytes\n\tPreferred vector widths: char " << widths[0] << ", short " << widths[1] << ", int "
+        << widths[2] << ", long " << widths[3] << ", float " << widths[4] << ", double " << widths[5] << ", half "
+        << widths[6] << "\n\tTimer resolution: " << caps.mTimerResolution
+        << " ns\n\tHost unified memory: " << (caps.mUnifiedMemory ? "yes" : "no")
+        << "\n\tSVM capabilities: " << caps.mSVMCapabilities << "\n}";
     return out;
 }
 
+void CLTestbench::WriteJSON(std::ostream& out, const Driver::DeviceCapabilities& caps)
+{
+    const auto& widths = caps.mPreferredVectorWidths;
+    out << "{\"name\": ";
+    WriteJSONString(out, caps.mName);
+    out << ", \"vendor\": ";
+    WriteJSONString(out, caps.mVendor);
+    out << ", \"version\": ";
+    WriteJSONString(out, caps.mVersion);
+    out << ", \"driver_version\": ";
+    WriteJSONString(out, caps.mDriverVersion);
+    out << ", \"type\": ";
+    WriteJSONString(out, DeviceTypeName(caps.mType));
+    out << ", \"compute_units\": " << caps.mComputeUnits << ", \"max_clock_frequency_mhz\": "
+        << caps.mMaxClockFrequency << ", \"max_work_group_size\": " << caps.mMaxWorkGroupSize
+        << ", \"max_work_item_sizes\": [" << caps.mMaxWorkItemSizes[0] << ", " << caps.mMaxWorkItemSizes[1] << ", "
+        << caps.mMaxWorkItemSizes[2] << "], \"global_mem_size\": " << caps.mGlobalMemSize
+        << ", \"max_mem_alloc_size\": " << caps.mMaxMemAllocSize
+        << ", \"global_mem_cache_size\": " << caps.mGlobalMemCacheSize
+        << ", \"global_mem_cacheline_size\": " << caps.mGlobalMemCacheLineSize
+        << ", \"local_mem_size\": " << caps.mLocalMemSize
+        << ", \"max_constant_buffer_size\": " << caps.mMaxConstantBufferSize
+        << ", \"base_address_alignment\": " << caps.mBaseAddressAlignment
+        << ", \"preferred_vector_widths\": {\"char\": " << widths[0] << ", \"short\": " << widths[1]
+        << ", \"int\": " << widths[2] << ", \"long\": " << widths[3] << ", \"float\": " << widths[4]
+        << ", \"double\": " << widths[5] << ", \"half\": " << widths[6]
+        << "}, \"timer_resolution_ns\": " << caps.mTimerResolution
+        << ", \"host_unified_memory\": " << (caps.mUnifiedMemory ? "true" : "false")
+        << ", \"svm_capabilities\": " << caps.mSVMCapabilities << '}';
+}
+
 void Driver::clearContext()
 {
+    clearProfile();
     if (!mContext)
         return;
+    // Pooled buffers belong to the context.
+    if (mBufferPool) mBufferPool->drain();
+    // Asynchronous reads still use the queues.
+    for (auto& read : mPendingReads) read.wait();
+    mPendingReads.clear();
+    if (mBackgroundQueue) {
+        mCLFns.clReleaseCommandQueue(mBackgroundQueue);
+        mBackgroundQueue = nullptr;
+    }
+    releaseDeviceQueues();
     if (mQueue) {
         mCLFns.clFinish(mQueue);
         mCLFns.clReleaseCommandQueue(mQueue);
@@ -138,8 +326,10 @@ Driver::operator cl_command_queue()
 
     cl_int err = CL_SUCCESS;
     cl_command_queue_properties properties = 0;
+    if (mProfile) properties |= CL_QUEUE_PROFILING_ENABLE;
     mQueue = mCLFns.clCreateCommandQueue(*this, mDevice, properties, &err);
     Checked(err);
+    sampleClock(mDevice);
     return mQueue;
 }
 
@@ -155,7 +345,9 @@ Driver::operator cl_context()
     void(CL_CALLBACK * pfnNotify)(const char*, const void*, size_t, void*) = nullptr;
     void* userData = nullptr;
     cl_int err = CL_SUCCESS;
-    mContext = mCLFns.clCreateContext(properties, 1, &mDevice, pfnNotify, userData, &err);
+    const std::vector<cl_device_id> devices = getDevices();
+    mContext = mCLFns.clCreateContext(properties, static_cast<cl_uint>(devices.size()), devices.data(), pfnNotify,
+                                      userData, &err);
     Checked(err);
     return mContext;
 }
@@ -163,16 +355,300 @@ Driver::operator cl_context()
 void Driver::flush()
 {
     BindFn(clFlush);
+    for (cl_command_queue queue : mDeviceQueues) {
+        if (queue) mCLFns.clFlush(queue);
+    }
     if (!mQueue) return;
     mCLFns.clFlush(*this);
 }
 
 void Driver::finish()
 {
+    for (cl_command_queue queue : mDeviceQueues) {
+        if (queue) mCLFns.clFinish(queue);
+    }
     if (!mQueue) return;
     mCLFns.clFinish(*this);
 }
 
+void Driver::selectDevices(std::vector<cl_device_id> devices)
+{
+    assert(!devices.empty() && "A device must be selected");
+    clearContext();
+    mCapabilitiesDevice = nullptr;
+    mDeviceInfoDevice = nullptr;
+    mDevice = devices.front();
+    if (devices.size() > 1) mDevices = std::move(devices);
+    else mDevices.clear();
+}
+
+std::vector<cl_device_id> Driver::getDevices() const
+{
+    if (mDevices.empty()) return {mDevice};
+    return mDevices;
+}
+
+cl_command_queue Driver::getDeviceQueue(std::size_t device)
+{
+    if (device == 0) return *this;
+    assert(device < mDevices.size() && "Device index out of range");
+
+    BindFn(clFinish);
+    BindFn(clCreateCommandQueue);
+    BindFn(clReleaseCommandQueue);
+
+    mDeviceQueues.resize(mDevices.size() - 1, nullptr);
+    cl_command_queue& queue = mDeviceQueues[device - 1];
+    if (queue) return queue;
+
+    // Like the default queue, these follow the profiling mode.
+    cl_int err = CL_SUCCESS;
+    cl_command_queue_properties properties = 0;
+    if (mProfile) properties |= CL_QUEUE_PROFILING_ENABLE;
+    queue = mCLFns.clCreateCommandQueue(*this, mDevices[device], properties, &err);
+    Checked(err);
+    sampleClock(mDevices[device]);
+    return queue;
+}
+
+cl_device_id Driver::getQueueDevice(cl_command_queue queue) const
+{
+    auto match = std::find(mDeviceQueues.begin(), mDeviceQueues.end(), queue);
+    if (queue && match != mDeviceQueues.end()) return mDevices[1 + (match - mDeviceQueues.begin())];
+    // The default queue, and queues created by 'queue' expressions, run on mDevice.
+    return mDevice;
+}
+
+void Driver::sampleClock(cl_device_id device, std::chrono::steady_clock::duration maxAge)
+{
+    if (mClockUnavailable) return;
+    if (!mCLFns.clGetDeviceAndHostTimer) {
+        // This is an OpenCL 2.1 function.
+        try {
+            BindFn(clGetDeviceAndHostTimer);
+        } catch (const Library::Error&) {
+            mClockUnavailable = true;
+            return;
+        }
+    }
+
+    auto clock = std::find_if(mClocks.begin(), mClocks.end(),
+                              [&](const DeviceClock& clock) { return clock.mDevice == device; });
+    const auto now = std::chrono::steady_clock::now();
+    if (clock != mClocks.end() && now - clock->mLastSample < maxAge) return;
+
+    // The host timer of clGetDeviceAndHostTimer may not be steady_clock, so the device time is
+    // paired with steady_clock readings around the call instead.
+    cl_ulong deviceTime = 0, hostTime = 0;
+    const auto before = std::chrono::steady_clock::now();
+    const cl_int err = mCLFns.clGetDeviceAndHostTimer(device, &deviceTime, &hostTime);
+    const auto after = std::chrono::steady_clock::now();
+    if (err != CL_SUCCESS) {
+        mClockUnavailable = true;
+        return;
+    }
+
+    if (clock == mClocks.end()) clock = mClocks.insert(mClocks.end(), DeviceClock{device, {}, {}});
+    const auto midpoint = before + (after - before) / 2;
+    const int64_t host =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(midpoint.time_since_epoch()).count();
+    clock->mSync.addSample({host, deviceTime});
+    clock->mLastSample = after;
+}
+
+const ClockSync* Driver::getClockSync(cl_device_id device) const
+{
+    auto clock = std::find_if(mClocks.begin(), mClocks.end(),
+                              [&](const DeviceClock& clock) { return clock.mDevice == device; });
+    if (clock == mClocks.end() || clock->mSync.empty()) return nullptr;
+    return &clock->mSync;
+}
+
+void Driver::releaseDeviceQueues() noexcept
+{
+    for (cl_command_queue queue : mDeviceQueues) {
+        if (!queue) continue;
+        mCLFns.clFinish(queue);
+        mCLFns.clReleaseCommandQueue(queue);
+    }
+    mDeviceQueues.clear();
+}
+
+void Driver::migrate(const std::vector<cl_mem>& objects, std::optional<std::size_t> device)
+{
+    BindFn(clEnqueueMigrateMemObjects);
+    if (objects.empty()) return;
+
+    cl_command_queue queue = getDeviceQueue(device.value_or(0));
+    const cl_mem_migration_flags flags = device ? 0 : CL_MIGRATE_MEM_OBJECT_HOST;
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
+    const cl_event* wait = nullptr;
+    Checked(mCLFns.clEnqueueMigrateMemObjects(queue, static_cast<cl_uint>(objects.size()), objects.data(), flags,
+                                               0, wait, event));
+    recordEvent(profiled, device ? "migrate to device " + std::to_string(*device) : std::string("migrate to host"),
+                queue);
+}
+
+void Driver::flush(cl_command_queue queue)
+{
+    BindFn(clFlush);
+    Checked(mCLFns.clFlush(queue));
+}
+
+void Driver::finish(cl_command_queue queue)
+{
+    Checked(mCLFns.clFinish(queue));
+}
+
+std::unique_ptr<QueueObject> Driver::createQueue(cl_command_queue_properties properties)
+{
+    BindFn(clFinish);
+    BindFn(clCreateCommandQueue);
+    BindFn(clReleaseCommandQueue);
+    if (properties & CL_QUEUE_PROFILING_ENABLE) {
+        // Its launches are recorded for 'stats', even when the default queue isn't profiling.
+        BindFn(clGetEventProfilingInfo);
+        BindFn(clWaitForEvents);
+        BindFn(clReleaseEvent);
+    }
+
+    cl_int err = CL_SUCCESS;
+    cl_command_queue queue = mCLFns.clCreateCommandQueue(*this, mDevice, properties, &err);
+    Checked(err);
+    sampleClock(mDevice);
+    auto queueObj = std::make_unique<QueueObject>(queue, mCLFns.clReleaseCommandQueue);
+    queueObj->data.mProperties = properties;
+    return queueObj;
+}
+
+std::unique_ptr<EventObject> Driver::wrapEvent(cl_event event)
+{
+    BindFn(clReleaseEvent);
+    return std::make_unique<EventObject>(event, mCLFns.clReleaseEvent);
+}
+
+void Driver::waitForEvents(const std::vector<cl_event>& events)
+{
+    BindFn(clWaitForEvents);
+    if (events.empty()) return;
+    Checked(mCLFns.clWaitForEvents(static_cast<cl_uint>(events.size()), events.data()));
+}
+
+void Driver::setProfiling(bool enable)
+{
+    if (mProfile == enable) return;
+
+    BindFn(clGetEventProfilingInfo);
+    BindFn(clWaitForEvents);
+    BindFn(clReleaseEvent);
+
+    mProfile = enable;
+    // The queue properties are fixed at creation, so the queue is
+    // dropped here and recreated with the new properties on next use.
+    // Events from the old queue remain valid.
+    releaseDeviceQueues();
+    if (mQueue) {
+        mCLFns.clFinish(mQueue);
+        mCLFns.clReleaseCommandQueue(mQueue);
+        mQueue = nullptr;
+    }
+}
+
+void Driver::recordEvent(cl_event event, std::string command, cl_command_queue queue)
+{
+    if (!event) return;
+    ProfileEntry entry;
+    entry.mCommand = std::move(command);
+    entry.mEvent = event;
+    entry.mQueue = queue ? queue : mQueue;
+    entry.mDevice = getQueueDevice(entry.mQueue);
+    entry.mHostEnqueued = std::chrono::steady_clock::now();
+    // Long sessions need fresh readings to follow the drift between the clocks.
+    sampleClock(entry.mDevice, std::chrono::seconds(1));
+    if (mTracing) {
+        mCLFns.clRetainEvent(event);
+        mTraceEntries.push_back(entry);
+    }
+    mProfileEntries.push_back(std::move(entry));
+}
+
+void Driver::startTrace()
+{
+    BindFn(clRetainEvent);
+    BindFn(clReleaseEvent);
+    BindFn(clWaitForEvents);
+    BindFn(clGetEventProfilingInfo);
+    mTracing = true;
+}
+
+std::vector<Driver::ProfileEntry> Driver::stopTrace()
+{
+    mTracing = false;
+    std::vector<ProfileEntry> entries = std::move(mTraceEntries);
+    mTraceEntries.clear();
+    try {
+        for (ProfileEntry& entry : entries) resolveProfile(entry);
+    } catch (...) {
+        for (ProfileEntry& entry : entries) {
+            if (entry.mEvent) mCLFns.clReleaseEvent(entry.mEvent);
+        }
+        throw;
+    }
+    return entries;
+}
+
+const std::vector<Driver::ProfileEntry>& Driver::getProfile()
+{
+    for (ProfileEntry& entry : mProfileEntries) {
+        resolveProfile(entry);
+    }
+    return mProfileEntries;
+}
+
+void Driver::resolveProfile(ProfileEntry& entry)
+{
+    if (!entry.mEvent) return;
+    Checked(mCLFns.clWaitForEvents(1, &entry.mEvent));
+    Checked(mCLFns.clGetEventProfilingInfo(entry.mEvent, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong),
+                                           &entry.mQueued, nullptr));
+    Checked(mCLFns.clGetEventProfilingInfo(entry.mEvent, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong),
+                                           &entry.mSubmit, nullptr));
+    Checked(mCLFns.clGetEventProfilingInfo(entry.mEvent, CL_PROFILING_COMMAND_START, sizeof(cl_ulong),
+                                           &entry.mStart, nullptr));
+    Checked(mCLFns.clGetEventProfilingInfo(entry.mEvent, CL_PROFILING_COMMAND_END, sizeof(cl_ulong),
+                                           &entry.mEnd, nullptr));
+    mCLFns.clReleaseEvent(entry.mEvent);
+    entry.mEvent = nullptr;
+
+    if (const ClockSync* sync = getClockSync(entry.mDevice)) {
+        using namespace std::chrono;
+        entry.mHostStart = steady_clock::time_point(duration_cast<steady_clock::duration>(
+            nanoseconds(sync->toHost(entry.mStart))));
+        entry.mHostEnd = steady_clock::time_point(duration_cast<steady_clock::duration>(
+            nanoseconds(sync->toHost(entry.mEnd))));
+    }
+}
+
+void Driver::clearProfile() noexcept
+{
+    for (ProfileEntry& entry : mProfileEntries) {
+        if (entry.mEvent) mCLFns.clReleaseEvent(entry.mEvent);
+    }
+    mProfileEntries.clear();
+    mTransferStats = {};
+}
+
+bool Driver::hasUnifiedMemory()
+{
+    return getDeviceCapabilities().mUnifiedMemory;
+}
+
+bool Driver::useMapping()
+{
+    return mTransfer == Transfer::Map && hasUnifiedMemory();
+}
+
 std::vector<cl_platform_id> Driver::getPlatformIDs()
 {
     cl_uint numPlatforms;
@@ -230,12 +706,98 @@ Driver::DeviceInfo Driver::getDeviceInfo(cl_device_id device)
 
     BuildString(mVersion, CL_DEVICE_VERSION)
     BuildString(mName, CL_DEVICE_NAME)
+    BuildString(mDriverVersion, CL_DRIVER_VERSION)
 
 #undef BuildString
 
     return info;
 }
 
+const Driver::DeviceInfo& Driver::getSelectedDeviceInfo()
+{
+    if (mDeviceInfoDevice != mDevice) {
+        mDeviceInfo = getDeviceInfo(mDevice);
+        mDeviceInfoDevice = mDevice;
+    }
+    return mDeviceInfo;
+}
+
+Driver::DeviceCapabilities Driver::queryDeviceCapabilities(cl_device_id device)
+{
+    BindFn(clGetDeviceInfo);
+    DeviceCapabilities caps;
+
+    // Buffer and launch validation need these.
+    auto query = [&](cl_device_info param, auto& value) {
+        Checked(mCLFns.clGetDeviceInfo(device, param, sizeof(value), &value, nullptr));
+    };
+    // The others are only shown, so a parameter the device doesn't know, such as one from a later
+    // OpenCL version, keeps its default.
+    auto queryOptional = [&](cl_device_info param, auto& value) {
+        auto result = value;
+        if (mCLFns.clGetDeviceInfo(device, param, sizeof(result), &result, nullptr) == CL_SUCCESS) value = result;
+    };
+    auto queryString = [&](cl_device_info param) {
+        size_t size = 0;
+        std::string text;
+        if (mCLFns.clGetDeviceInfo(device, param, 0, nullptr, &size) != CL_SUCCESS) return text;
+        text.resize(size);
+        if (mCLFns.clGetDeviceInfo(device, param, size, text.data(), nullptr) != CL_SUCCESS) text.clear();
+        // Drop the null terminator.
+        if (!text.empty() && text.back() == '\0') text.pop_back();
+        return text;
+    };
+
+    caps.mName = queryString(CL_DEVICE_NAME);
+    caps.mVendor = queryString(CL_DEVICE_VENDOR);
+    caps.mVersion = queryString(CL_DEVICE_VERSION);
+    caps.mDriverVersion = queryString(CL_DRIVER_VERSION);
+    queryOptional(CL_DEVICE_TYPE, caps.mType);
+    queryOptional(CL_DEVICE_MAX_COMPUTE_UNITS, caps.mComputeUnits);
+    queryOptional(CL_DEVICE_MAX_CLOCK_FREQUENCY, caps.mMaxClockFrequency);
+    queryOptional(CL_DEVICE_MAX_WORK_GROUP_SIZE, caps.mMaxWorkGroupSize);
+    // Devices report at least three dimensions, but may report more.
+    cl_uint dimensions = 0;
+    query(CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS, dimensions);
+    std::vector<std::size_t> sizes(std::max<cl_uint>(dimensions, 3));
+    Checked(mCLFns.clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizes.size() * sizeof(std::size_t),
+                                   sizes.data(), nullptr));
+    std::copy_n(sizes.begin(), caps.mMaxWorkItemSizes.size(), caps.mMaxWorkItemSizes.begin());
+    query(CL_DEVICE_GLOBAL_MEM_SIZE, caps.mGlobalMemSize);
+    query(CL_DEVICE_MAX_MEM_ALLOC_SIZE, caps.mMaxMemAllocSize);
+    queryOptional(CL_DEVICE_GLOBAL_MEM_CACHE_SIZE, caps.mGlobalMemCacheSize);
+    queryOptional(CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE, caps.mGlobalMemCacheLineSize);
+    queryOptional(CL_DEVICE_LOCAL_MEM_SIZE, caps.mLocalMemSize);
+    queryOptional(CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE, caps.mMaxConstantBufferSize);
+    cl_uint alignmentBits = 0;
+    query(CL_DEVICE_MEM_BASE_ADDR_ALIGN, alignmentBits);
+    caps.mBaseAddressAlignment = alignmentBits / 8;
+    const cl_device_info widths[] = {
+        CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR, CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT,
+        CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT, CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG,
+        CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT, CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE,
+        CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF,
+    };
+    for (std::size_t i = 0; i < caps.mPreferredVectorWidths.size(); ++i)
+        queryOptional(widths[i], caps.mPreferredVectorWidths[i]);
+    queryOptional(CL_DEVICE_PROFILING_TIMER_RESOLUTION, caps.mTimerResolution);
+    cl_bool unified = CL_FALSE;
+    queryOptional(CL_DEVICE_HOST_UNIFIED_MEMORY, unified);
+    caps.mUnifiedMemory = unified == CL_TRUE;
+    // Devices before OpenCL 2.0 don't know this query.
+    queryOptional(CL_DEVICE_SVM_CAPABILITIES, caps.mSVMCapabilities);
+    return caps;
+}
+
+const Driver::DeviceCapabilities& Driver::getDeviceCapabilities()
+{
+    if (mCapabilitiesDevice != mDevice) {
+        mCapabilities = queryDeviceCapabilities(mDevice);
+        mCapabilitiesDevice = mDevice;
+    }
+    return mCapabilities;
+}
+
 std::unique_ptr<ProgramObject> Driver::createProgram(std::string_view source)
 {
     BindFn(clCreateProgramWithSource);
@@ -274,7 +836,48 @@ void Driver::buildProgram(cl_program program, const char* opts)
     void (*pfnNotify)(cl_program, void*) = nullptr;
     void* userData = nullptr;
 
-    Checked(mCLFns.clBuildProgram(program, 1, &mDevice, opts, pfnNotify, userData));
+    // Build for every device the program was created for, which may be several.
+    Checked(mCLFns.clBuildProgram(program, 0, nullptr, opts, pfnNotify, userData));
+}
+
+std::shared_future<void> Driver::buildProgramAsync(cl_program program, std::string opts)
+{
+    BindFn(clBuildProgram);
+    BindFn(clRetainProgram);
+    BindFn(clReleaseProgram);
+
+    // Drop the builds which already finished.
+    mBuilds.erase(std::remove_if(mBuilds.begin(), mBuilds.end(),
+                                 [](const std::shared_future<void>& build) {
+                                     return build.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                                 }),
+                  mBuilds.end());
+
+    // The worker must not bind functions, so it only gets what it needs.
+    Checked(mCLFns.clRetainProgram(program));
+    auto build = [program, opts = std::move(opts), buildFn = mCLFns.clBuildProgram,
+                  releaseFn = mCLFns.clReleaseProgram]() {
+        const cl_int error = buildFn(program, 0, nullptr, opts.c_str(), nullptr, nullptr);
+        releaseFn(program);
+        if (error != CL_SUCCESS) throw Error(error);
+    };
+
+    std::shared_future<void> future;
+    try {
+        future = std::async(std::launch::async, build).share();
+    } catch (const std::system_error&) {
+        // No thread could be started; build here instead.
+        std::promise<void> done;
+        try {
+            build();
+            done.set_value();
+        } catch (...) {
+            done.set_exception(std::current_exception());
+        }
+        future = done.get_future().share();
+    }
+    mBuilds.push_back(future);
+    return future;
 }
 
 std::string Driver::programBuildLog(cl_program program)
@@ -293,13 +896,25 @@ std::vector<char> Driver::programBinary(cl_program program)
 {
     BindFn(clGetProgramInfo);
 
-    size_t binarySize = 0;
+    // Programs of a multi-device context have a binary for each device.  Only the selected device's is returned.
     size_t outputSize = 0;
-    Checked(mCLFns.clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(binarySize), &binarySize, &outputSize));
-    std::vector<char> binary;
-    binary.resize(binarySize);
-    char* binaryData = binary.data();
-    Checked(mCLFns.clGetProgramInfo(program, CL_PROGRAM_BINARIES, binarySize, &binaryData, &outputSize));
+    Checked(mCLFns.clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, 0, nullptr, &outputSize));
+    std::vector<size_t> binarySizes(outputSize / sizeof(size_t));
+    if (binarySizes.empty()) return {};
+    Checked(mCLFns.clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, binarySizes.size() * sizeof(size_t),
+                                    binarySizes.data(), nullptr));
+    std::vector<cl_device_id> devices(binarySizes.size());
+    Checked(mCLFns.clGetProgramInfo(program, CL_PROGRAM_DEVICES, devices.size() * sizeof(cl_device_id),
+                                    devices.data(), nullptr));
+    auto device = std::find(devices.begin(), devices.end(), mDevice);
+    const std::size_t index = device == devices.end() ? 0 : static_cast<std::size_t>(device - devices.begin());
+
+    std::vector<char> binary(binarySizes[index]);
+    // Binaries are only written for the non-null entries.
+    std::vector<char*> binaryData(binarySizes.size(), nullptr);
+    binaryData[index] = binary.data();
+    Checked(mCLFns.clGetProgramInfo(program, CL_PROGRAM_BINARIES, binaryData.size() * sizeof(char*),
+                                    binaryData.data(), nullptr));
     return binary;
 }
 
@@ -311,7 +926,10 @@ std::unique_ptr<KernelObject> Driver::createKernel(cl_program program, const cha
     cl_int err = CL_SUCCESS;
     cl_kernel kernel = mCLFns.clCreateKernel(program, name, &err);
     Checked(err);
-    return std::make_unique<KernelObject>(kernel, mCLFns.clReleaseKernel);
+    auto kernelObj = std::make_unique<KernelObject>(kernel, mCLFns.clReleaseKernel);
+    kernelObj->data.mName = name;
+    kernelObj->data.mArgs = getKernelArgInfo(kernel);
+    return kernelObj;
 }
 
 std::unique_ptr<KernelObject> Driver::cloneKernel(cl_kernel kernel)
@@ -322,49 +940,520 @@ std::unique_ptr<KernelObject> Driver::cloneKernel(cl_kernel kernel)
     cl_int err = CL_SUCCESS;
     cl_kernel clone = mCLFns.clCloneKernel(kernel, &err);
     Checked(err);
-    return std::make_unique<KernelObject>(clone, mCLFns.clReleaseKernel);
+    auto kernelObj = std::make_unique<KernelObject>(clone, mCLFns.clReleaseKernel);
+    kernelObj->data.mArgs = getKernelArgInfo(clone);
+    return kernelObj;
+}
+
+std::string Driver::getKernelName(cl_kernel kernel)
+{
+    BindFn(clGetKernelInfo);
+
+    size_t size = 0;
+    Checked(mCLFns.clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, 0, nullptr, &size));
+    std::string name;
+    name.resize(size);
+    Checked(mCLFns.clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, size, name.data(), &size));
+    // Drop the null terminator.
+    if (!name.empty() && name.back() == '\0') name.pop_back();
+    return name;
+}
+
+std::vector<KernelArgInfo> Driver::getKernelArgInfo(cl_kernel kernel)
+{
+    BindFn(clGetKernelInfo);
+    // OpenCL 1.1 implementations have no argument metadata.
+    try {
+        BindFn(clGetKernelArgInfo);
+    } catch (const Library::Error&) {
+        return {};
+    }
+
+    cl_uint numArgs = 0;
+    Checked(mCLFns.clGetKernelInfo(kernel, CL_KERNEL_NUM_ARGS, sizeof(numArgs), &numArgs, nullptr));
+
+    auto getString = [&](cl_uint index, cl_kernel_arg_info param) {
+        size_t size = 0;
+        Checked(mCLFns.clGetKernelArgInfo(kernel, index, param, 0, nullptr, &size));
+        std::string text;
+        text.resize(size);
+        Checked(mCLFns.clGetKernelArgInfo(kernel, index, param, size, text.data(), nullptr));
+        // Drop the null terminator.
+        if (!text.empty() && text.back() == '\0') text.pop_back();
+        return text;
+    };
+
+    std::vector<KernelArgInfo> args(numArgs);
+    for (cl_uint i = 0; i < numArgs; ++i) {
+        KernelArgInfo& arg = args[i];
+        const cl_int err = mCLFns.clGetKernelArgInfo(kernel, i, CL_KERNEL_ARG_ADDRESS_QUALIFIER, sizeof(arg.mAddress),
+                                                     &arg.mAddress, nullptr);
+        if (err == CL_KERNEL_ARG_INFO_NOT_AVAILABLE) return {};
+        Checked(err);
+        Checked(mCLFns.clGetKernelArgInfo(kernel, i, CL_KERNEL_ARG_ACCESS_QUALIFIER, sizeof(arg.mAccess),
+                                          &arg.mAccess, nullptr));
+        Checked(mCLFns.clGetKernelArgInfo(kernel, i, CL_KERNEL_ARG_TYPE_QUALIFIER, sizeof(arg.mTypeQualifier),
+                                          &arg.mTypeQualifier, nullptr));
+        arg.mTypeName = getString(i, CL_KERNEL_ARG_TYPE_NAME);
+        // Some implementations keep the types, but not the names, without -cl-kernel-arg-info.
+        try {
+            arg.mName = getString(i, CL_KERNEL_ARG_NAME);
+        } catch (const Error& e) {
+            if (e.mError != CL_KERNEL_ARG_INFO_NOT_AVAILABLE) throw;
+        }
+    }
+    return args;
 }
 
-std::unique_ptr<MemoryObject> Driver::createBuffer(std::size_t size)
+Driver::KernelLimits Driver::getKernelLimits(cl_kernel kernel)
+{
+    BindFn(clGetKernelWorkGroupInfo);
+
+    KernelLimits limits;
+    Checked(mCLFns.clGetKernelWorkGroupInfo(kernel, mDevice, CL_KERNEL_WORK_GROUP_SIZE,
+                                            sizeof(limits.mMaxWorkGroupSize), &limits.mMaxWorkGroupSize, nullptr));
+    Checked(mCLFns.clGetKernelWorkGroupInfo(kernel, mDevice, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+                                            sizeof(limits.mPreferredMultiple), &limits.mPreferredMultiple, nullptr));
+    limits.mMaxWorkItemSizes = getDeviceCapabilities().mMaxWorkItemSizes;
+    return limits;
+}
+
+std::unique_ptr<MemoryObject> Driver::createBuffer(std::size_t size, cl_mem_flags flags, void* hostPtr)
 {
     BindFn(clCreateBuffer);
     BindFn(clReleaseMemObject);
 
-    cl_int err = CL_SUCCESS;
-    cl_mem buffer = mCLFns.clCreateBuffer(*this, CL_MEM_READ_WRITE, size, nullptr, &err);
-    Checked(err);
-    auto bufferObj = std::make_unique<MemoryObject>(buffer, mCLFns.clReleaseMemObject);
+    // Buffers using host memory are tied to it, so they aren't pooled.
+    const bool pooled = !hostPtr && mBufferPool && mBufferPool->isEnabled();
+    std::size_t allocSize = size;
+    BufferPool::Lease lease;
+    if (pooled) {
+        allocSize = BufferPool::SizeClass(size);
+        const cl_ulong maxAlloc = getDeviceCapabilities().mMaxMemAllocSize;
+        if (maxAlloc != 0 && allocSize > maxAlloc) allocSize = size;
+        lease = mBufferPool->acquire(allocSize, flags);
+    }
+
+    cl_mem buffer = nullptr;
+    if (lease) {
+        buffer = lease.get();
+    } else {
+        cl_int err = CL_SUCCESS;
+        buffer = mCLFns.clCreateBuffer(*this, flags, allocSize, hostPtr, &err);
+        Checked(err);
+        if (pooled) lease = mBufferPool->adopt(buffer, allocSize, flags);
+    }
+    // The lease owns the reference to a pooled buffer.
+    auto bufferObj = std::make_unique<MemoryObject>(buffer, pooled ? KeepReference : mCLFns.clReleaseMemObject);
     bufferObj->data.mBufferSize = size;
+    bufferObj->data.mFlags = flags;
+    bufferObj->data.mPoolLease = std::move(lease);
+    bufferObj->data.mLedgerRecord = mLedger->add(allocSize, flags, false);
+    if (flags & CL_MEM_COPY_HOST_PTR) mTransferStats.mCopiedToDevice += size;
     return bufferObj;
 }
 
+void Driver::setBufferPoolLimit(std::size_t bytes)
+{
+    if (!mBufferPool) {
+        if (bytes == 0) return;
+        BindFn(clReleaseMemObject);
+        mBufferPool = std::make_shared<BufferPool>(mCLFns.clReleaseMemObject);
+    }
+    mBufferPool->setLimit(bytes);
+}
+
+void* Driver::mapBuffer(cl_mem buffer, cl_map_flags flags, std::size_t offset, std::size_t size)
+{
+    BindFn(clEnqueueMapBuffer);
+
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
+    const cl_event* wait = nullptr;
+    cl_int err = CL_SUCCESS;
+    void* mapped = mCLFns.clEnqueueMapBuffer(*this, buffer, CL_TRUE, flags, offset, size, 0, wait, event, &err);
+    Checked(err);
+    recordEvent(profiled, "map buffer");
+    // Data written to the mapping reaches the device when it's unmapped.
+    if (flags & CL_MAP_READ) mTransferStats.mMappedFromDevice += size;
+    if (flags & (CL_MAP_WRITE | CL_MAP_WRITE_INVALIDATE_REGION)) mTransferStats.mMappedToDevice += size;
+    return mapped;
+}
+
+void Driver::unmapBuffer(cl_mem buffer, void* mapped)
+{
+    BindFn(clEnqueueUnmapMemObject);
+
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
+    const cl_event* wait = nullptr;
+    Checked(mCLFns.clEnqueueUnmapMemObject(*this, buffer, mapped, 0, wait, event));
+    recordEvent(profiled, "unmap buffer");
+}
+
 void Driver::writeBuffer(cl_mem buffer, const void* data, std::size_t offset, std::size_t size)
 {
+    if (useMapping()) {
+        void* mapped = mapBuffer(buffer, CL_MAP_WRITE_INVALIDATE_REGION, offset, size);
+        std::memcpy(mapped, data, size);
+        unmapBuffer(buffer, mapped);
+        return;
+    }
+
     BindFn(clEnqueueWriteBuffer);
 
     cl_bool blocking = mBlock ? CL_TRUE : CL_FALSE;
-    cl_event* event = nullptr;
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
     const cl_event* wait = nullptr;
     Checked(mCLFns.clEnqueueWriteBuffer(*this, buffer, blocking, offset, size, data, 0, wait, event));
+    recordEvent(profiled, "write buffer");
+    mTransferStats.mCopiedToDevice += size;
+}
+
+void Driver::bindStagingFns()
+{
+    BindFn(clCreateBuffer);
+    BindFn(clReleaseMemObject);
+    BindFn(clEnqueueMapBuffer);
+    BindFn(clEnqueueUnmapMemObject);
+    BindFn(clWaitForEvents);
+    BindFn(clReleaseEvent);
+}
+
+void Driver::streamBuffer(cl_mem buffer, const void* data, std::size_t size)
+{
+    if (mStreamChunk == 0 || size <= mStreamChunk || useMapping()) {
+        writeBuffer(buffer, data, 0, size);
+        return;
+    }
+
+    BindFn(clEnqueueWriteBuffer);
+    BindFn(clFlush);
+    BindFn(clRetainEvent);
+    bindStagingFns();
+
+    const auto start = std::chrono::steady_clock::now();
+    cl_command_queue queue = *this;
+    const std::size_t chunkSize = mStreamChunk;
+    StagingBuffers staging(*this, queue, 2, chunkSize);
+    if (!staging.allocate()) {
+        // Pinned memory is limited; write the data directly instead.
+        writeBuffer(buffer, data, 0, size);
+        return;
+    }
+
+    const auto* source = static_cast<const char*>(data);
+    for (std::size_t offset = 0, chunk = 0; offset < size; offset += chunkSize, ++chunk) {
+        const std::size_t i = chunk % staging.size();
+        const std::size_t length = std::min(chunkSize, size - offset);
+        // A staging buffer is refilled once its previous chunk is written.
+        staging.wait(i);
+        std::memcpy(staging.mapped(i), source + offset, length);
+
+        cl_event write = nullptr;
+        Checked(mCLFns.clEnqueueWriteBuffer(queue, buffer, CL_FALSE, offset, length, staging.mapped(i), 0, nullptr,
+                                            &write));
+        Checked(mCLFns.clFlush(queue));
+        staging.setTransfer(i, write);
+        if (mProfile && write) {
+            mCLFns.clRetainEvent(write);
+            recordEvent(write, "write buffer chunk", queue);
+        }
+    }
+    for (std::size_t i = 0; i < staging.size(); ++i) staging.wait(i);
+
+    mTransferStats.mCopiedToDevice += size;
+    mTransferStats.mStreamedToDevice += size;
+    mTransferStats.mStreamToDeviceTime += std::chrono::steady_clock::now() - start;
+}
+
+void Driver::streamReadBuffer(cl_mem buffer, std::size_t size, const ChunkConsumer& consume)
+{
+    auto readAtOnce = [&] {
+        std::vector<char> data(size);
+        readBuffer(buffer, data.data(), 0, size);
+        consume(data.data(), 0, size).get();
+    };
+    if (mStreamChunk == 0 || size <= mStreamChunk || useMapping()) return readAtOnce();
+
+    BindFn(clEnqueueReadBuffer);
+    BindFn(clFlush);
+    BindFn(clRetainEvent);
+    bindStagingFns();
+
+    const auto start = std::chrono::steady_clock::now();
+    cl_command_queue queue = *this;
+    std::function<void(cl_event)> record;
+    if (mProfile) record = [&](cl_event read) { recordEvent(read, "read buffer chunk", queue); };
+    if (!readChunks(queue, buffer, size, mStreamChunk, consume, nullptr, record))
+        return readAtOnce();
+
+    mTransferStats.mCopiedFromDevice += size;
+    mTransferStats.mStreamedFromDevice += size;
+    mTransferStats.mStreamFromDeviceTime += std::chrono::steady_clock::now() - start;
+}
+
+bool Driver::readChunks(cl_command_queue queue, cl_mem buffer, std::size_t size, std::size_t chunkSize,
+                        const ChunkConsumer& consume, cl_event after, const std::function<void(cl_event)>& onRead)
+{
+    // One chunk is read while the previous one is consumed, and another waits to be.
+    StagingBuffers staging(*this, queue, 3, chunkSize);
+    if (!staging.allocate()) return false;
+
+    // Hands a chunk which has been read to the consumer.
+    auto consumeChunk = [&](std::size_t chunk) {
+        const std::size_t i = chunk % staging.size();
+        const std::size_t offset = chunk * chunkSize;
+        staging.wait(i);
+        staging.setConsumed(i, consume(staging.mapped(i), offset, std::min(chunkSize, size - offset)));
+    };
+
+    const std::size_t chunks = (size + chunkSize - 1) / chunkSize;
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        const std::size_t i = chunk % staging.size();
+        const std::size_t offset = chunk * chunkSize;
+        // A staging buffer is read into once its previous chunk is consumed.
+        staging.waitConsumed(i);
+
+        cl_event read = nullptr;
+        // The queue is in order, so only the first read needs to wait.
+        const cl_uint waits = chunk == 0 && after ? 1 : 0;
+        Checked(mCLFns.clEnqueueReadBuffer(queue, buffer, CL_FALSE, offset, std::min(chunkSize, size - offset),
+                                           staging.mapped(i), waits, waits ? &after : nullptr, &read));
+        Checked(mCLFns.clFlush(queue));
+        staging.setTransfer(i, read);
+        if (onRead && read) {
+            mCLFns.clRetainEvent(read);
+            onRead(read);
+        }
+        if (chunk > 0) consumeChunk(chunk - 1);
+    }
+    consumeChunk(chunks - 1);
+    for (std::size_t i = 0; i < staging.size(); ++i) staging.waitConsumed(i);
+    return true;
 }
 
 void Driver::readBuffer(cl_mem buffer, void* data, std::size_t offset, std::size_t size)
 {
+    if (useMapping()) {
+        void* mapped = mapBuffer(buffer, CL_MAP_READ, offset, size);
+        std::memcpy(data, mapped, size);
+        unmapBuffer(buffer, mapped);
+        return;
+    }
+
     BindFn(clEnqueueReadBuffer);
 
     cl_bool blocking = mBlock ? CL_TRUE : CL_FALSE;
-    cl_event* event = nullptr;
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
     const cl_event* wait = nullptr;
     Checked(mCLFns.clEnqueueReadBuffer(*this, buffer, blocking, offset, size, data, 0, wait, event));
+    recordEvent(profiled, "read buffer");
+    mTransferStats.mCopiedFromDevice += size;
+}
+
+std::shared_future<void> Driver::streamReadBufferAsync(cl_mem buffer, std::size_t size, ChunkConsumer consume)
+{
+    // Drop the reads which already finished.
+    mPendingReads.erase(std::remove_if(mPendingReads.begin(), mPendingReads.end(),
+                                       [](const std::shared_future<void>& read) {
+                                           return read.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                                       }),
+                        mPendingReads.end());
+
+    auto readNow = [&] {
+        std::promise<void> done;
+        try {
+            streamReadBuffer(buffer, size, consume);
+            done.set_value();
+        } catch (...) {
+            done.set_exception(std::current_exception());
+        }
+        return done.get_future().share();
+    };
+
+    // The worker mustn't bind functions, so everything it calls is bound here.
+    BindFn(clEnqueueReadBuffer);
+    BindFn(clFlush);
+    BindFn(clRetainEvent);
+    BindFn(clCreateCommandQueue);
+    BindFn(clReleaseCommandQueue);
+    bindStagingFns();
+    try {
+        BindFn(clCreateUserEvent);
+        BindFn(clSetUserEventStatus);
+        BindFn(clEnqueueMarkerWithWaitList);
+        BindFn(clEnqueueBarrierWithWaitList);
+    } catch (const Library::Error&) {
+        // The default queue can't be made to wait for the worker before OpenCL 1.2.
+        return readNow();
+    }
+
+    if (!mBackgroundQueue) {
+        cl_int err = CL_SUCCESS;
+        mBackgroundQueue = mCLFns.clCreateCommandQueue(*this, mDevice, 0, &err);
+        Checked(err);
+    }
+
+    // The read starts after the commands enqueued so far, and the default queue waits for it to finish.
+    cl_command_queue queue = *this;
+    cl_event after = nullptr;
+    Checked(mCLFns.clEnqueueMarkerWithWaitList(queue, 0, nullptr, &after));
+    cl_int err = CL_SUCCESS;
+    cl_event done = mCLFns.clCreateUserEvent(*this, &err);
+    if (err == CL_SUCCESS) err = mCLFns.clEnqueueBarrierWithWaitList(queue, 1, &done, nullptr);
+    if (err == CL_SUCCESS) err = mCLFns.clFlush(queue);
+    // Completes the user event, even if the read fails, so that the default queue doesn't wait forever.
+    auto complete = [setStatusFn = mCLFns.clSetUserEventStatus, releaseFn = mCLFns.clReleaseEvent, after, done] {
+        if (done) {
+            setStatusFn(done, CL_COMPLETE);
+            releaseFn(done);
+        }
+        if (after) releaseFn(after);
+    };
+    if (err != CL_SUCCESS) {
+        complete();
+        throw Error(err);
+    }
+
+    // The worker gets its own copies of what the main thread may change meanwhile.
+    auto read = [this, backgroundQueue = mBackgroundQueue, chunkSize = mStreamChunk, buffer, size, consume, after,
+                 complete]() mutable {
+        struct Completion
+        {
+            const decltype(complete)& mComplete;
+            ~Completion() { mComplete(); }
+        } completion{complete};
+        // The consumer is dropped before the future is ready, rather than with it.
+        const ChunkConsumer consumer = std::move(consume);
+
+        if (chunkSize != 0 && size > chunkSize &&
+            readChunks(backgroundQueue, buffer, size, chunkSize, consumer, after, nullptr))
+            return;
+        // Small buffers, or without staging buffers, the whole buffer is read at once.
+        std::vector<char> data(size);
+        Checked(mCLFns.clEnqueueReadBuffer(backgroundQueue, buffer, CL_TRUE, 0, size, data.data(), after ? 1 : 0,
+                                           after ? &after : nullptr, nullptr));
+        consumer(data.data(), 0, size).get();
+    };
+
+    std::shared_future<void> future;
+    try {
+        future = std::async(std::launch::async, read).share();
+    } catch (const std::system_error&) {
+        // No thread could be started.  The barrier passes, so the buffer is read here instead.
+        complete();
+        return readNow();
+    }
+    mTransferStats.mCopiedFromDevice += size;
+    mPendingReads.push_back(future);
+    return future;
 }
 
 void Driver::copyBuffer(cl_mem src, cl_mem dst, size_t srcOffset, size_t dstOffset, size_t size)
 {
     BindFn(clEnqueueCopyBuffer);
 
-    cl_event* event = nullptr;
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
     const cl_event* wait = nullptr;
     Checked(mCLFns.clEnqueueCopyBuffer(*this, src, dst, srcOffset, dstOffset, size, 0, wait, event));
+    recordEvent(profiled, "copy buffer");
+}
+
+void Driver::fillBuffer(cl_mem buffer, const void* pattern, std::size_t patternSize, std::size_t offset,
+                        std::size_t size)
+{
+    BindFn(clEnqueueFillBuffer);
+
+    // The pattern is copied when enqueued, so it need not outlive this call.
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
+    const cl_event* wait = nullptr;
+    Checked(mCLFns.clEnqueueFillBuffer(*this, buffer, pattern, patternSize, offset, size, 0, wait, event));
+    recordEvent(profiled, "fill buffer");
+}
+
+std::unique_ptr<MemoryObject> Driver::createSubBuffer(cl_mem buffer, std::size_t offset, std::size_t size)
+{
+    BindFn(clCreateSubBuffer);
+    BindFn(clReleaseMemObject);
+
+    cl_int err = CL_SUCCESS;
+    const cl_buffer_region region{offset, size};
+    cl_mem subBuffer = mCLFns.clCreateSubBuffer(buffer, 0, CL_BUFFER_CREATE_TYPE_REGION, &region, &err);
+    Checked(err);
+    auto bufferObj = std::make_unique<MemoryObject>(subBuffer, mCLFns.clReleaseMemObject);
+    bufferObj->data.mBufferSize = size;
+    bufferObj->data.mParentOffset = offset;
+    return bufferObj;
+}
+
+std::size_t Driver::getBaseAddressAlignment()
+{
+    return getDeviceCapabilities().mBaseAddressAlignment;
+}
+
+cl_device_svm_capabilities Driver::getSVMCapabilities()
+{
+    return getDeviceCapabilities().mSVMCapabilities;
+}
+
+std::unique_ptr<SVMObject> Driver::allocateSVM(std::size_t size, cl_svm_mem_flags flags)
+{
+    BindFn(clSVMAlloc);
+    BindFn(clSVMFree);
+    BindFn(clRetainContext);
+    BindFn(clReleaseContext);
+
+    cl_context context = *this;
+    // The default alignment is used.
+    void* pointer = mCLFns.clSVMAlloc(context, flags, size, 0);
+    // clSVMAlloc doesn't report why it failed.
+    if (!pointer) throw Error(CL_MEM_OBJECT_ALLOCATION_FAILURE);
+    if (cl_int err = mCLFns.clRetainContext(context); err != CL_SUCCESS) {
+        mCLFns.clSVMFree(context, pointer);
+        throw Error(err);
+    }
+    return std::make_unique<SVMObject>(context, pointer, size, flags, mCLFns.clSVMFree, mCLFns.clReleaseContext);
+}
+
+void Driver::mapSVM(void* pointer, cl_map_flags flags, std::size_t size)
+{
+    BindFn(clEnqueueSVMMap);
+
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
+    const cl_event* wait = nullptr;
+    Checked(mCLFns.clEnqueueSVMMap(*this, CL_TRUE, flags, pointer, size, 0, wait, event));
+    recordEvent(profiled, "map svm");
+    if (flags & CL_MAP_READ) mTransferStats.mMappedFromDevice += size;
+    if (flags & (CL_MAP_WRITE | CL_MAP_WRITE_INVALIDATE_REGION)) mTransferStats.mMappedToDevice += size;
+}
+
+void Driver::unmapSVM(void* pointer)
+{
+    BindFn(clEnqueueSVMUnmap);
+
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
+    const cl_event* wait = nullptr;
+    Checked(mCLFns.clEnqueueSVMUnmap(*this, pointer, 0, wait, event));
+    recordEvent(profiled, "unmap svm");
+}
+
+void Driver::copySVM(void* dst, const void* src, std::size_t size)
+{
+    BindFn(clEnqueueSVMMemcpy);
+
+    cl_bool blocking = mBlock ? CL_TRUE : CL_FALSE;
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
+    const cl_event* wait = nullptr;
+    Checked(mCLFns.clEnqueueSVMMemcpy(*this, blocking, dst, src, size, 0, wait, event));
+    recordEvent(profiled, "copy svm");
 }
 
 std::size_t Driver::getBufferSize(cl_mem buffer)
@@ -389,18 +1478,63 @@ void Driver::setKernelArg(cl_kernel kernel, uint32_t index, const void* data, st
     Checked(mCLFns.clSetKernelArg(kernel, index, size, data));
 }
 
-void Driver::enqueueKernel(cl_kernel kernel, EnqueueSize global,
-                           std::optional<EnqueueSize> local)
+void Driver::setKernelArgSVM(cl_kernel kernel, uint32_t index, const void* pointer)
+{
+    BindFn(clSetKernelArgSVMPointer);
+    Checked(mCLFns.clSetKernelArgSVMPointer(kernel, index, pointer));
+}
+
+void Driver::enqueueKernel(KernelObject& kernel, EnqueueSize global, std::optional<EnqueueSize> local,
+                           std::optional<EnqueueSize> offset, cl_event* event, QueueObject* queueObj,
+                           const std::vector<cl_event>& waitList, bool record)
+{
+    // Launches on other queues are recorded if that queue was created for profiling.
+    bool profiling = mProfile;
+    cl_command_queue queue = nullptr;
+    if (queueObj) {
+        profiling = queueObj->data.mProperties & CL_QUEUE_PROFILING_ENABLE;
+        queue = *queueObj;
+    } else {
+        queue = *this;
+    }
+    enqueueNDRange(queue, kernel, offset ? &*offset : nullptr, global, local, waitList, event, profiling && record,
+                   std::string());
+}
+
+void Driver::enqueueKernelOnDevice(std::size_t device, KernelObject& kernel, EnqueueSize offset, EnqueueSize global,
+                                   std::optional<EnqueueSize> local, const std::vector<cl_event>& waitList)
+{
+    cl_command_queue queue = getDeviceQueue(device);
+    enqueueNDRange(queue, kernel, &offset, global, local, waitList, nullptr, mProfile,
+                   " on device " + std::to_string(device));
+}
+
+void Driver::enqueueNDRange(cl_command_queue queue, KernelObject& kernel, const EnqueueSize* offset,
+                            const EnqueueSize& global, const std::optional<EnqueueSize>& local,
+                            const std::vector<cl_event>& waitList, cl_event* event, bool profiling,
+                            const std::string& suffix)
 {
     BindFn(clEnqueueNDRangeKernel);
 
     cl_uint dim = 1;
     if (global[2] != 0) dim = 3;
     else if (global[1] != 0) dim = 2;
+    const std::size_t* offsets = offset ? offset->data() : nullptr;
     const std::size_t* localSize = local ? local->data() : nullptr;
-
-    Checked(mCLFns.clEnqueueNDRangeKernel(*this, kernel, dim, nullptr, global.data(),
-                                          localSize, 0, nullptr, nullptr));
+    cl_event profiled = nullptr;
+    if (profiling && !event) event = &profiled;
+    // The caller owns a requested event, so the profile keeps a reference of its own.
+    if (profiling && event != &profiled) BindFn(clRetainEvent);
+    std::string command = profiling ? "run " + kernel.data.mName + suffix : std::string();
+
+    const cl_event* wait = waitList.empty() ? nullptr : waitList.data();
+    Checked(mCLFns.clEnqueueNDRangeKernel(queue, kernel, dim, offsets, global.data(), localSize,
+                                          static_cast<cl_uint>(waitList.size()), wait, event));
+    if (profiling && event != &profiled && *event) {
+        mCLFns.clRetainEvent(*event);
+        profiled = *event;
+    }
+    recordEvent(profiled, std::move(command), queue);
 }
 
 std::unique_ptr<MemoryObject> Driver::createImage(const cl_image_format& format, const cl_image_desc& desc,
@@ -410,44 +1544,140 @@ std::unique_ptr<MemoryObject> Driver::createImage(const cl_image_format& format,
     BindFn(clReleaseMemObject);
     cl_int err;
     cl_int flags = CL_MEM_READ_WRITE;
-    if (data != nullptr) flags |= CL_MEM_COPY_HOST_PTR;
-    cl_mem image = mCLFns.clCreateImage(*this, flags, &format, &desc, const_cast<void*>(data), &err);
+    // When mapping, the data is written once the image exists.
+    const bool copyData = data != nullptr && !useMapping();
+    if (copyData) flags |= CL_MEM_COPY_HOST_PTR;
+    cl_mem image =
+        mCLFns.clCreateImage(*this, flags, &format, &desc, copyData ? const_cast<void*>(data) : nullptr, &err);
     Checked(err);
     auto imageObj = std::make_unique<MemoryObject>(image, mCLFns.clReleaseMemObject);
     imageObj->data.mDescriptor = desc;
     imageObj->data.mFormat = format;
+    imageObj->data.mFlags = flags;
     // We can probably calculate this value ourselves.
     imageObj->data.mBufferSize = getBufferSize(image);
+    imageObj->data.mLedgerRecord = mLedger->add(imageObj->data.mBufferSize, flags, true);
+    if (copyData) {
+        mTransferStats.mCopiedToDevice += imageObj->data.mBufferSize;
+    } else if (data) {
+        ImageCoords region{desc.image_width, desc.image_height, desc.image_depth};
+        if (region[2] == 0) {
+            region[2] = 1;
+            if (region[1] == 0) region[1] = 1;
+        }
+        transferImageMapped(image, const_cast<void*>(data), {}, region, true);
+    }
     return imageObj;
 }
 
 void Driver::writeImage(cl_mem img, const void* data, ImageCoords origin, ImageCoords region)
 {
+    if (useMapping()) {
+        transferImageMapped(img, const_cast<void*>(data), origin, region, true);
+        return;
+    }
+
     BindFn(clEnqueueWriteImage);
 
     cl_bool blocking = mBlock ? CL_TRUE : CL_FALSE;
-    cl_event* event = nullptr;
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
     const cl_event* wait = nullptr;
     size_t pitch = 0;
     Checked(mCLFns.clEnqueueWriteImage(*this, img, blocking, origin.data(), region.data(), pitch, pitch, data, 0, wait, event));
+    recordEvent(profiled, "write image");
+    mTransferStats.mCopiedToDevice += getImageRegionSize(img, region);
 }
 
 void Driver::readImage(cl_mem img, void* data, ImageCoords origin, ImageCoords region)
 {
+    if (useMapping()) {
+        transferImageMapped(img, data, origin, region, false);
+        return;
+    }
+
     BindFn(clEnqueueReadImage);
 
     cl_bool blocking = mBlock ? CL_TRUE : CL_FALSE;
-    cl_event* event = nullptr;
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
     const cl_event* wait = nullptr;
     size_t pitch = 0;
     Checked(mCLFns.clEnqueueReadImage(*this, img, blocking, origin.data(), region.data(), pitch, pitch, data, 0, wait, event));
+    recordEvent(profiled, "read image");
+    mTransferStats.mCopiedFromDevice += getImageRegionSize(img, region);
 }
 
 void Driver::copyImage(cl_mem src, cl_mem dst, ImageCoords srcOrigin, ImageCoords dstOrigin, ImageCoords region)
 {
     BindFn(clEnqueueCopyImage);
 
-    cl_event* event = nullptr;
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
     const cl_event* wait = nullptr;
     Checked(mCLFns.clEnqueueCopyImage(*this, src, dst, srcOrigin.data(), dstOrigin.data(), region.data(), 0, wait, event));
+    recordEvent(profiled, "copy image");
+}
+
+void* Driver::mapImage(cl_mem img, cl_map_flags flags, ImageCoords origin, ImageCoords region,
+                       std::size_t& rowPitch, std::size_t& slicePitch)
+{
+    BindFn(clEnqueueMapImage);
+
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
+    const cl_event* wait = nullptr;
+    cl_int err = CL_SUCCESS;
+    void* mapped = mCLFns.clEnqueueMapImage(*this, img, CL_TRUE, flags, origin.data(), region.data(), &rowPitch,
+                                            &slicePitch, 0, wait, event, &err);
+    Checked(err);
+    recordEvent(profiled, "map image");
+    const std::size_t size = getImageRegionSize(img, region);
+    if (flags & CL_MAP_READ) mTransferStats.mMappedFromDevice += size;
+    if (flags & (CL_MAP_WRITE | CL_MAP_WRITE_INVALIDATE_REGION)) mTransferStats.mMappedToDevice += size;
+    return mapped;
+}
+
+void Driver::unmapImage(cl_mem img, void* mapped)
+{
+    BindFn(clEnqueueUnmapMemObject);
+
+    cl_event profiled = nullptr;
+    cl_event* event = mProfile ? &profiled : nullptr;
+    const cl_event* wait = nullptr;
+    Checked(mCLFns.clEnqueueUnmapMemObject(*this, img, mapped, 0, wait, event));
+    recordEvent(profiled, "unmap image");
+}
+
+std::size_t Driver::getImageRegionSize(cl_mem img, ImageCoords region)
+{
+    BindFn(clGetImageInfo);
+
+    std::size_t elementSize = 0;
+    Checked(mCLFns.clGetImageInfo(img, CL_IMAGE_ELEMENT_SIZE, sizeof(elementSize), &elementSize, nullptr));
+    return elementSize * region[0] * region[1] * region[2];
+}
+
+void Driver::transferImageMapped(cl_mem img, void* data, ImageCoords origin, ImageCoords region, bool toDevice)
+{
+    std::size_t rowPitch = 0;
+    std::size_t slicePitch = 0;
+    const cl_map_flags flags = toDevice ? CL_MAP_WRITE_INVALIDATE_REGION : CL_MAP_READ;
+    auto* mapped = static_cast<char*>(mapImage(img, flags, origin, region, rowPitch, slicePitch));
+
+    // The host data is tightly packed, as with the read and write commands, but the mapping may be padded.
+    const std::size_t rowSize = getImageRegionSize(img, {region[0], 1, 1});
+    if (rowPitch == 0) rowPitch = rowSize;
+    if (slicePitch == 0) slicePitch = rowPitch * region[1];
+    auto* host = static_cast<char*>(data);
+    for (std::size_t slice = 0; slice < region[2]; ++slice) {
+        for (std::size_t row = 0; row < region[1]; ++row) {
+            char* device = mapped + slice * slicePitch + row * rowPitch;
+            if (toDevice) std::memcpy(device, host, rowSize);
+            else std::memcpy(host, device, rowSize);
+            host += rowSize;
+        }
+    }
+
+    unmapImage(img, mapped);
 }
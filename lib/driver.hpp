@@ -15,6 +15,10 @@
 
 #pragma once
 #include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <iosfwd>
 #include <memory>
 #include <optional>
@@ -24,7 +28,10 @@
 
 #include <CL/cl_icd.h>
 
+#include "bufferpool.hpp"
+#include "clocksync.hpp"
 #include "library.hpp"
+#include "memoryledger.hpp"
 #include "object_cl.hpp"
 
 namespace CLTestbench
@@ -41,6 +48,11 @@ class Driver final
 
     /// The default CL queue for commands.
     cl_command_queue mQueue = nullptr;
+    /// The queue of streamReadBufferAsync, created on first use.
+    cl_command_queue mBackgroundQueue = nullptr;
+
+    /// Whether the queue is created with profiling enabled.
+    bool mProfile = false;
 
     void clearContext();
     operator cl_context();
@@ -58,9 +70,53 @@ public:
     /// The selected device.
     cl_device_id mDevice = nullptr;
 
+    /// Selects the devices of the context, which is recreated on next use.  The first device
+    /// becomes mDevice, and runs the commands of the default queue.  Objects of the previous
+    /// context must have been released.
+    void selectDevices(std::vector<cl_device_id>);
+    /// The devices of the context: mDevice, followed by any other selected devices.
+    std::vector<cl_device_id> getDevices() const;
+
     /// Whether the commands are submitted to the queue as blocking commands.
     bool mBlock = true;
 
+    /// How data is moved between the host and memory objects.
+    enum class Transfer
+    {
+        /// Explicit read and write commands.
+        Copy,
+        /// Mapping the memory object, when the device shares memory with the host.
+        Map
+    };
+    Transfer mTransfer = Transfer::Copy;
+    /// Whether the selected device reports CL_DEVICE_HOST_UNIFIED_MEMORY.
+    bool hasUnifiedMemory();
+
+    /// Bytes moved between the host and memory objects, by transfer path.
+    struct TransferStats
+    {
+        std::uint64_t mCopiedToDevice = 0;
+        std::uint64_t mCopiedFromDevice = 0;
+        std::uint64_t mMappedToDevice = 0;
+        std::uint64_t mMappedFromDevice = 0;
+        /// Bytes moved in chunks by streamBuffer and streamReadBuffer, which the copied bytes
+        /// include, and the time it took.
+        std::uint64_t mStreamedToDevice = 0;
+        std::uint64_t mStreamedFromDevice = 0;
+        std::chrono::steady_clock::duration mStreamToDeviceTime{};
+        std::chrono::steady_clock::duration mStreamFromDeviceTime{};
+    };
+    const TransferStats& getTransferStats() const noexcept { return mTransferStats; }
+
+    /// Device memory allocated by the buffers and images created so far.
+    const MemoryLedger& getMemoryLedger() const noexcept { return *mLedger; }
+
+    /// Keeps released buffers for reuse by createBuffer, up to this many idle bytes.
+    /// Zero disables the pool, which is the default.
+    void setBufferPoolLimit(std::size_t bytes);
+    /// The buffer pool, or null if it was never enabled.
+    const BufferPool* getBufferPool() const noexcept { return mBufferPool.get(); }
+
     /// Encodes a CL error.
     class Error final : public std::exception
     {
@@ -87,46 +143,319 @@ public:
         // so we query only what's required for identification.
         std::string mName;
         std::string mVersion;
+        std::string mDriverVersion;
+    };
+
+    /// Device properties that performance work depends on.
+    struct DeviceCapabilities
+    {
+        std::string mName;
+        std::string mVendor;
+        std::string mVersion;
+        std::string mDriverVersion;
+        cl_device_type mType = 0;
+        cl_uint mComputeUnits = 0;
+        /// In MHz.
+        cl_uint mMaxClockFrequency = 0;
+        std::size_t mMaxWorkGroupSize = 0;
+        std::array<std::size_t, 3> mMaxWorkItemSizes{};
+        cl_ulong mGlobalMemSize = 0;
+        cl_ulong mMaxMemAllocSize = 0;
+        cl_ulong mGlobalMemCacheSize = 0;
+        cl_uint mGlobalMemCacheLineSize = 0;
+        cl_ulong mLocalMemSize = 0;
+        cl_ulong mMaxConstantBufferSize = 0;
+        /// CL_DEVICE_MEM_BASE_ADDR_ALIGN, converted to bytes.
+        std::size_t mBaseAddressAlignment = 0;
+        /// Preferred vector widths of char, short, int, long, float, double and half.
+        std::array<cl_uint, 7> mPreferredVectorWidths{};
+        /// In nanoseconds.
+        std::size_t mTimerResolution = 0;
+        bool mUnifiedMemory = false;
+        /// Zero for devices before OpenCL 2.0.
+        cl_device_svm_capabilities mSVMCapabilities = 0;
+    };
+    /// Only the work-item sizes, memory sizes and base address alignment are required.  Other
+    /// parameters the device doesn't support are left zero or empty.
+    DeviceCapabilities queryDeviceCapabilities(cl_device_id);
+    /// The capabilities of the selected device, queried once after it is selected.
+    const DeviceCapabilities& getDeviceCapabilities();
+
+    /// Timing information of a command enqueued while profiling is enabled.
+    struct ProfileEntry
+    {
+        /// Describes the command, such as "run kernelName" or "write".
+        std::string mCommand;
+        /// The command's event.  Released once the timings have been retrieved.
+        cl_event mEvent = nullptr;
+        /// Device timestamps (in nanoseconds) from clGetEventProfilingInfo.
+        cl_ulong mQueued = 0;
+        cl_ulong mSubmit = 0;
+        cl_ulong mStart = 0;
+        cl_ulong mEnd = 0;
+        /// The queue the command was enqueued on, and its device.
+        cl_command_queue mQueue = nullptr;
+        cl_device_id mDevice = nullptr;
+        /// Host time just after the command was enqueued.
+        std::chrono::steady_clock::time_point mHostEnqueued;
+        /// mStart and mEnd on the host clock, if the device clock is synchronised; see getClockSync.
+        std::optional<std::chrono::steady_clock::time_point> mHostStart;
+        std::optional<std::chrono::steady_clock::time_point> mHostEnd;
     };
 
+    /// Readings of the device and host clocks, in steady_clock nanoseconds, or null if
+    /// clGetDeviceAndHostTimer is unavailable.  The clocks are read when queues are created,
+    /// and again by profiled commands once the last reading is a second old.
+    const ClockSync* getClockSync(cl_device_id) const;
+
+    /// Starts keeping every profiled command for a trace, in addition to the profile for 'stats'.
+    /// Profiling must be enabled for commands to be recorded.
+    void startTrace();
+    /// Stops the trace, returning its commands once they finish.
+    std::vector<ProfileEntry> stopTrace();
+
+    /// Enables or disables profiling.  The command queue is recreated
+    /// if it already exists, after any pending commands finish.
+    void setProfiling(bool);
+    bool isProfiling() const noexcept { return mProfile; }
+
+    /// Enables profiling for the lifetime of the guard, restoring the previous mode afterwards.
+    class ProfilingGuard final
+    {
+        Driver& mDriver;
+        const bool mWasProfiling;
+
+    public:
+        explicit ProfilingGuard(Driver& driver) : mDriver(driver), mWasProfiling(driver.isProfiling())
+        {
+            mDriver.setProfiling(true);
+        }
+        ProfilingGuard(const ProfilingGuard&) = delete;
+        ProfilingGuard& operator=(const ProfilingGuard&) = delete;
+
+        ~ProfilingGuard()
+        {
+            try {
+                mDriver.setProfiling(mWasProfiling);
+            } catch (...) {
+                // Leave the queue with profiling enabled; it's harmless.
+            }
+        }
+    };
+
+    /// Waits for all profiled commands to finish and retrieves their timings.
+    const std::vector<ProfileEntry>& getProfile();
+    /// Waits for the entry's event and retrieves its timings.  The event is then released.
+    /// Requires profiling to have been enabled when the command was enqueued.
+    void resolveProfile(ProfileEntry&);
+    /// Discards all profiling entries and transfer statistics.
+    void clearProfile() noexcept;
+
     /// Flushes the command queue.
     void flush();
     /// Waits for the command queue to finish.
     void finish();
+    void flush(cl_command_queue);
+    void finish(cl_command_queue);
+
+    /// The queue of a device, indexed as in getDevices().  The first is the default queue.
+    cl_command_queue getDeviceQueue(std::size_t device);
+    /// Migrates the memory objects to a device, indexed as in getDevices(), or to the host.
+    void migrate(const std::vector<cl_mem>&, std::optional<std::size_t> device);
+
+    /// Creates a command queue, besides the default one, on the selected device.
+    std::unique_ptr<QueueObject> createQueue(cl_command_queue_properties);
+    /// Takes ownership of an event returned by an enqueue.
+    std::unique_ptr<EventObject> wrapEvent(cl_event);
+    void waitForEvents(const std::vector<cl_event>&);
 
     std::vector<cl_platform_id> getPlatformIDs();
     PlatformInfo getPlatformInfo(cl_platform_id);
     std::vector<cl_device_id> getDeviceIDs(cl_platform_id);
     DeviceInfo getDeviceInfo(cl_device_id);
+    /// The information of the selected device, queried once per device.
+    const DeviceInfo& getSelectedDeviceInfo();
 
     std::unique_ptr<ProgramObject> createProgram(std::string_view source);
     std::unique_ptr<ProgramObject> createProgramBinary(const void* binary, std::size_t size);
     void buildProgram(cl_program, const char* opts);
+    /// Builds the program on a worker thread, returning immediately.  The program is
+    /// retained until the build finishes, and the future rethrows any build error.
+    std::shared_future<void> buildProgramAsync(cl_program, std::string opts);
     std::string programBuildLog(cl_program);
     std::vector<char> programBinary(cl_program);
 
     std::unique_ptr<KernelObject> createKernel(cl_program, const char* name);
     std::unique_ptr<KernelObject> cloneKernel(cl_kernel);
+    std::string getKernelName(cl_kernel);
+    /// Queries the metadata of every argument.  This is empty if the information isn't available.
+    std::vector<KernelArgInfo> getKernelArgInfo(cl_kernel);
+
+    /// Creates a buffer.  The host pointer is given to clCreateBuffer, as required by the flags.
+    /// Without one, the buffer comes from the buffer pool when enabled; see setBufferPoolLimit.
+    std::unique_ptr<MemoryObject> createBuffer(std::size_t, cl_mem_flags flags = CL_MEM_READ_WRITE,
+                                               void* hostPtr = nullptr);
 
-    std::unique_ptr<MemoryObject> createBuffer(std::size_t);
+    /// The reads and writes below, and those of images, map the memory object instead of
+    /// copying when the 'map' transfer mode is set and the device has unified memory.
+    /// Mapped transfers always block.
     void writeBuffer(cl_mem, const void* data, std::size_t offset, std::size_t size);
+    /// Writes data larger than mStreamChunk in chunks.  Each chunk is copied into one of two pinned
+    /// staging buffers while the previous chunk is written to the device, so that reading the data,
+    /// such as from a file mapping, overlaps with the transfer.  This blocks until the data is
+    /// written.  Smaller data, and mapped transfers, are written as by writeBuffer.
+    void streamBuffer(cl_mem, const void* data, std::size_t size);
+    /// Receives a chunk of the buffer read by streamReadBuffer, at its offset within the buffer.  The
+    /// chunk must stay readable until the returned future is ready.
+    using ChunkConsumer = std::function<std::future<void>(const void* data, std::size_t offset, std::size_t size)>;
+    /// Reads a buffer larger than mStreamChunk in chunks, through three pinned staging buffers, with
+    /// non-blocking reads.  Each chunk is passed to the consumer once read, while the next one is
+    /// read, so that the consumer can write chunks to disk as the transfer continues.  This blocks
+    /// until every chunk is consumed, and rethrows the consumer's errors.  Smaller buffers, and
+    /// mapped transfers, are read into a single chunk as by readBuffer.
+    void streamReadBuffer(cl_mem, std::size_t size, const ChunkConsumer&);
+    /// The chunk size of streamBuffer and streamReadBuffer.  Zero disables streaming.
+    std::size_t mStreamChunk = 64 * 1024 * 1024;
     void readBuffer(cl_mem, void* data, size_t offset, size_t size);
+    /// Runs streamReadBuffer on a worker thread, through a queue of its own, and returns at once.
+    /// The read waits for the commands already on the default queue, and later commands on it wait
+    /// for the read, so the data is that of the buffer when this is called; commands on other queues
+    /// aren't ordered with it.  The consumer is called on the worker.  The chunks aren't recorded
+    /// for 'stats'.  The future rethrows the errors of the read and of the consumer.  Without
+    /// OpenCL 1.2 or threads, this reads the buffer before returning.
+    std::shared_future<void> streamReadBufferAsync(cl_mem, std::size_t size, ChunkConsumer);
     void copyBuffer(cl_mem src, cl_mem dst, size_t srcOffset, size_t dstOffet, size_t size);
+    /// Fills the buffer region with the repeated pattern, on the device.
+    void fillBuffer(cl_mem, const void* pattern, std::size_t patternSize, std::size_t offset, std::size_t size);
     size_t getBufferSize(cl_mem);
+    /// Creates a sub-buffer over a region of the buffer.  It inherits the buffer's flags.
+    std::unique_ptr<MemoryObject> createSubBuffer(cl_mem, std::size_t offset, std::size_t size);
+    /// CL_DEVICE_MEM_BASE_ADDR_ALIGN, converted to bytes.
+    std::size_t getBaseAddressAlignment();
+    /// Maps a buffer region into host memory.  This always blocks until the mapping is ready.
+    void* mapBuffer(cl_mem, cl_map_flags, std::size_t offset, std::size_t size);
+    void unmapBuffer(cl_mem, void* mapped);
+
+    /// CL_DEVICE_SVM_CAPABILITIES of the selected device.
+    cl_device_svm_capabilities getSVMCapabilities();
+    std::unique_ptr<SVMObject> allocateSVM(std::size_t, cl_svm_mem_flags);
+    /// Maps a coarse-grained SVM region for host access.  This always blocks until the mapping is ready.
+    void mapSVM(void*, cl_map_flags, std::size_t size);
+    void unmapSVM(void*);
+    void copySVM(void* dst, const void* src, std::size_t size);
 
     void setKernelArg(cl_kernel kernel, uint32_t index, cl_mem memObj);
     void setKernelArg(cl_kernel kernel, uint32_t index, const void* data, std::size_t size);
+    void setKernelArgSVM(cl_kernel kernel, uint32_t index, const void* pointer);
 
     using EnqueueSize = std::array<size_t, 3>;
-    void enqueueKernel(cl_kernel, EnqueueSize global, std::optional<EnqueueSize> local);
+
+    /// Work-group limits for running a kernel on the selected device.
+    struct KernelLimits
+    {
+        /// CL_KERNEL_WORK_GROUP_SIZE
+        std::size_t mMaxWorkGroupSize = 0;
+        /// CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE
+        std::size_t mPreferredMultiple = 1;
+        /// CL_DEVICE_MAX_WORK_ITEM_SIZES
+        EnqueueSize mMaxWorkItemSizes{};
+    };
+    KernelLimits getKernelLimits(cl_kernel);
+
+    /// Enqueues the kernel on the queue, or the default queue if none is given, once the
+    /// events in the wait list complete.  If an event is requested, the caller owns it; when
+    /// profiling, the command is recorded for 'stats' with a reference of its own, unless
+    /// 'record' is false, as for timings the caller collects itself.
+    void enqueueKernel(KernelObject&, EnqueueSize global, std::optional<EnqueueSize> local,
+                       std::optional<EnqueueSize> offset = std::nullopt, cl_event* event = nullptr,
+                       QueueObject* queue = nullptr, const std::vector<cl_event>& waitList = {},
+                       bool record = true);
+
+    /// Enqueues part of a launch, starting at the global offset, on a device's queue; see getDeviceQueue.
+    void enqueueKernelOnDevice(std::size_t device, KernelObject&, EnqueueSize offset, EnqueueSize global,
+                               std::optional<EnqueueSize> local, const std::vector<cl_event>& waitList = {});
 
     using ImageCoords = std::array<size_t, 3>;
     std::unique_ptr<MemoryObject> createImage(const cl_image_format&, const cl_image_desc&, const void* = nullptr);
     void writeImage(cl_mem, const void* data, ImageCoords origin, ImageCoords region);
     void readImage(cl_mem, void* data, ImageCoords origin, ImageCoords region);
     void copyImage(cl_mem src, cl_mem dst, ImageCoords srcOrigin, ImageCoords dstOrigin, ImageCoords region);
+    /// Maps an image region into host memory, returning its row and slice pitches.
+    /// This always blocks until the mapping is ready.
+    void* mapImage(cl_mem, cl_map_flags, ImageCoords origin, ImageCoords region, std::size_t& rowPitch,
+                   std::size_t& slicePitch);
+    void unmapImage(cl_mem, void* mapped);
+
+private:
+    /// Every device of the context when several are selected, starting with mDevice.
+    std::vector<cl_device_id> mDevices;
+    /// Queues of mDevices, past the first, created on first use.
+    std::vector<cl_command_queue> mDeviceQueues;
+    void releaseDeviceQueues() noexcept;
+
+    TransferStats mTransferStats;
+    /// Shared with the records of the memory objects, which may outlive the driver.
+    std::shared_ptr<MemoryLedger> mLedger = std::make_shared<MemoryLedger>();
+    /// Created when first enabled.  Shared with the leases of the pooled buffers.
+    std::shared_ptr<BufferPool> mBufferPool;
+    /// The device which mCapabilities describes.
+    cl_device_id mCapabilitiesDevice = nullptr;
+    DeviceCapabilities mCapabilities;
+    /// The device which mDeviceInfo describes.
+    cl_device_id mDeviceInfoDevice = nullptr;
+    DeviceInfo mDeviceInfo;
+    class StagingBuffers;
+    void bindStagingFns();
+    /// The chunked reads of streamReadBuffer on the queue, after the event if given.  This doesn't bind
+    /// functions or record anything, so that it can run on a worker; the chunk reads are passed to
+    /// onRead, which takes ownership of their events.  Returns false if no staging buffers could
+    /// be allocated, before reading anything.
+    bool readChunks(cl_command_queue, cl_mem, std::size_t size, std::size_t chunkSize, const ChunkConsumer&,
+                    cl_event after, const std::function<void(cl_event)>& onRead);
+    /// Whether transfers go through mappings; see Transfer.
+    bool useMapping();
+    /// Copies an image region between packed host data and a mapping of the image.
+    void transferImageMapped(cl_mem, void* data, ImageCoords origin, ImageCoords region, bool toDevice);
+    /// Size in bytes of the image region, when tightly packed.
+    std::size_t getImageRegionSize(cl_mem, ImageCoords region);
+
+    /// Builds started by buildProgramAsync.  These must finish before the library is unloaded.
+    std::vector<std::shared_future<void>> mBuilds;
+    /// Reads started by streamReadBufferAsync.  These must finish before the queues are released.
+    std::vector<std::shared_future<void>> mPendingReads;
+
+    /// Commands enqueued while profiling was enabled.
+    std::vector<ProfileEntry> mProfileEntries;
+    struct DeviceClock
+    {
+        cl_device_id mDevice = nullptr;
+        ClockSync mSync;
+        std::chrono::steady_clock::time_point mLastSample;
+    };
+    std::vector<DeviceClock> mClocks;
+    /// Set once clGetDeviceAndHostTimer is found to be missing or unsupported.
+    bool mClockUnavailable = false;
+    /// Reads the device and host clocks together, if the last reading is older than maxAge.
+    void sampleClock(cl_device_id, std::chrono::steady_clock::duration maxAge = {});
+    /// The device that runs the commands of the queue.
+    cl_device_id getQueueDevice(cl_command_queue) const;
+
+    /// Commands enqueued while tracing.  These hold their own reference to the event.
+    bool mTracing = false;
+    std::vector<ProfileEntry> mTraceEntries;
+
+    void enqueueNDRange(cl_command_queue, KernelObject&, const EnqueueSize* offset, const EnqueueSize& global,
+                        const std::optional<EnqueueSize>& local, const std::vector<cl_event>& waitList,
+                        cl_event* event, bool profiling, const std::string& suffix);
+
+    /// Keeps track of the event of a profiled command.  The event may be null
+    /// if profiling is disabled, in which case nothing is recorded.
+    void recordEvent(cl_event, std::string command, cl_command_queue = nullptr);
 };
 
 std::ostream& operator<<(std::ostream&, const Driver::PlatformInfo&);
 std::ostream& operator<<(std::ostream&, const Driver::DeviceInfo&);
+std::ostream& operator<<(std::ostream&, const Driver::DeviceCapabilities&);
+/// Writes the capabilities as a JSON object.
+void WriteJSON(std::ostream&, const Driver::DeviceCapabilities&);
 } // namespace CLTestbench
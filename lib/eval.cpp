@@ -17,6 +17,7 @@
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <string>
 #include <type_traits>
 #include <vector>
 
@@ -160,8 +161,70 @@ std::shared_ptr<ParsedDataObject<T>> ParseBuffer(TokenStream& tokens)
 
     return std::make_shared<ParsedDataObject<T>>(std::move(values));
 }
+
+template<typename T>
+std::shared_ptr<ParsedDataObject<T>> ParseScalarAs(const TokenStream& tokens, Token token)
+{
+    using ParseTy = typename std::conditional<std::is_same_v<T, HalfFP>, double, T>::type;
+    T value = tokens.parseConstant<ParseTy>(token);
+    return std::make_shared<ParsedDataObject<T>>(std::vector<T>{value});
+}
+
+/// Spells "unsigned X" types as "uX".
+std::string CanonicalScalarName(std::string_view typeName)
+{
+    constexpr std::string_view Unsigned = "unsigned ";
+    if (typeName.substr(0, Unsigned.size()) == Unsigned) return "u" + std::string(typeName.substr(Unsigned.size()));
+    return std::string(typeName);
+}
 } // namespace
 
+// The types below are the same as for data objects, in Testbench::evaluate.
+std::shared_ptr<DataObject> CLTestbench::ParseScalar(const TokenStream& tokens, Token token,
+                                                     std::string_view typeName)
+{
+    const std::string name = CanonicalScalarName(typeName);
+#define CLTypeParseScalar(TYPE, CTYPE) \
+    if (name == #TYPE) return ParseScalarAs<CTYPE>(tokens, token)
+
+    CLTypeParseScalar(half, HalfFP);
+    CLTypeParseScalar(float, float);
+    CLTypeParseScalar(double, double);
+    CLTypeParseScalar(char, int8_t);
+    CLTypeParseScalar(uchar, uint8_t);
+    CLTypeParseScalar(short, int16_t);
+    CLTypeParseScalar(ushort, uint16_t);
+    CLTypeParseScalar(int, int32_t);
+    CLTypeParseScalar(uint, uint32_t);
+    CLTypeParseScalar(long, int64_t);
+    CLTypeParseScalar(ulong, uint64_t);
+
+#undef CLTypeParseScalar
+    return nullptr;
+}
+
+std::size_t CLTestbench::ScalarTypeSize(std::string_view typeName)
+{
+    const std::string name = CanonicalScalarName(typeName);
+#define CLTypeSize(TYPE, CTYPE) \
+    if (name == #TYPE) return sizeof(CTYPE)
+
+    CLTypeSize(half, uint16_t);
+    CLTypeSize(float, float);
+    CLTypeSize(double, double);
+    CLTypeSize(char, int8_t);
+    CLTypeSize(uchar, uint8_t);
+    CLTypeSize(short, int16_t);
+    CLTypeSize(ushort, uint16_t);
+    CLTypeSize(int, int32_t);
+    CLTypeSize(uint, uint32_t);
+    CLTypeSize(long, int64_t);
+    CLTypeSize(ulong, uint64_t);
+
+#undef CLTypeSize
+    return 0;
+}
+
 std::shared_ptr<Object> Testbench::evaluate(TokenStream& tokens)
 {
     if (!tokens) throw CommandError("Unexpected end-of-input.");
@@ -227,6 +290,34 @@ std::shared_ptr<Object> Testbench::evaluate(TokenStream& tokens)
         return evaluateBuffer(tokens);
     }
 
+    if (tokenText == "queue") {
+        if (!mDriver) {
+            throw CommandError("A driver is required for a 'queue' expression.", token);
+        }
+        return evaluateQueue(tokens);
+    }
+
+    if (tokenText == "run") {
+        if (!mDriver) {
+            throw CommandError("A driver is required for a 'run' expression.", token);
+        }
+        return evaluateRun(tokens);
+    }
+
+    if (tokenText == "svm") {
+        if (!mDriver) {
+            throw CommandError("A driver is required for a 'svm' expression.", token);
+        }
+        return evaluateSVM(tokens);
+    }
+
+    if (tokenText == "slice") {
+        if (!mDriver) {
+            throw CommandError("A driver is required for a 'slice' expression.", token);
+        }
+        return evaluateSlice(tokens);
+    }
+
     if (tokenText == "image") {
         if (!mDriver) {
             throw CommandError("A driver is required for a 'image' expression.", token);
@@ -14,13 +14,15 @@
 // along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <algorithm>
+#include <cassert>
 #include <charconv>
 #include <filesystem>
-#include <fstream>
-#include <istream>
 #include <limits>
-#include <streambuf>
-#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <CL/cl.h>
 
@@ -50,21 +52,47 @@ T parse(Token token, std::string_view arg)
     return val;
 }
 
+/// Closes the file descriptor when leaving scope.
+struct FileDescriptor final
+{
+    const int mFD;
+    explicit FileDescriptor(int fd) noexcept : mFD(fd) {}
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+    ~FileDescriptor()
+    {
+        if (mFD >= 0) close(mFD);
+    }
+};
+
+/// File contents, mapped into memory instead of read into a copy.
+/// The mapping is private, so writes (such as through a 'use_host' buffer) never reach the file.
+/// Pages are only read from disk as they are accessed.
 class FileDataObject final : public DataObject
 {
     const std::string mFilename;
-    std::vector<char> mData;
+    /// The mapping, which starts at the page containing the first byte of the data.
+    void* const mMapping;
+    const std::size_t mMappingSize;
+    /// Offset of the data within the mapping.
+    const std::size_t mOffset;
 
 public:
-    FileDataObject(std::string filename, std::vector<char> data) : mFilename(filename), mData(std::move(data)) {}
+    FileDataObject(std::string filename, void* mapping, std::size_t mappingSize, std::size_t offset) :
+        mFilename(std::move(filename)), mMapping(mapping), mMappingSize(mappingSize), mOffset(offset)
+    {
+        assert(offset < mappingSize);
+    }
+    FileDataObject(const FileDataObject&) = delete;
+    FileDataObject& operator=(const FileDataObject&) = delete;
 
-    std::size_t size() const noexcept override { return mData.size(); }
+    std::size_t size() const noexcept override { return mMappingSize - mOffset; }
 
-    const void* data() const noexcept override { return static_cast<const void*>(mData.data()); }
+    const void* data() const noexcept override { return static_cast<const char*>(mMapping) + mOffset; }
 
     std::string_view type() const noexcept override { return mFilename; }
 
-    ~FileDataObject() = default;
+    ~FileDataObject() { munmap(mMapping, mMappingSize); }
 };
 } // namespace
 
@@ -117,12 +145,13 @@ std::shared_ptr<Object> Testbench::evaluateFile(TokenStream& tokens)
         throw CommandError("File does not exist.", filenameToken);
     }
 
-    std::ifstream file(filepath, std::ios::ate);
-    if (!file.is_open()) {
+    FileDescriptor file(open(filepath.c_str(), O_RDONLY | O_CLOEXEC));
+    struct stat fileStat {};
+    if (file.mFD < 0 || fstat(file.mFD, &fileStat) != 0) {
         throw CommandError("Could not open file.", filenameToken);
     }
 
-    std::streamsize fileSize = file.tellg();
+    const std::streamsize fileSize = fileStat.st_size;
     if (fileSize == 0)
         throw CommandError("Empty file.", filenameToken);
 
@@ -142,10 +171,18 @@ std::shared_ptr<Object> Testbench::evaluateFile(TokenStream& tokens)
         *mOut << "Length of " << parsedLen << " given to 'file' command clamped to " << length << '\n';
     }
 
-    std::vector<char> data;
-    data.resize(static_cast<decltype(data)::size_type>(length));
-    file.seekg(start);
-    file.read(data.data(), length);
+    // Only map the pages holding the requested range.  The mapping must start on a page boundary.
+    const auto pageSize = static_cast<std::streamsize>(sysconf(_SC_PAGESIZE));
+    const std::streamsize mappingStart = start - start % pageSize;
+    const auto mappingSize = static_cast<std::size_t>(length + (start - mappingStart));
+    void* mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, file.mFD, mappingStart);
+    if (mapping == MAP_FAILED) {
+        throw CommandError("Could not map file into memory.", filenameToken);
+    }
+    // Data objects are mostly consumed front to back, such as by buffer uploads.
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+    auto data = std::make_unique<FileDataObject>(std::string(filename), mapping, mappingSize,
+                                                 static_cast<std::size_t>(start - mappingStart));
 
 #if CLTB_USE_LIBPNG
     if (filepath.extension() == ".png") {
@@ -155,10 +192,10 @@ std::shared_ptr<Object> Testbench::evaluateFile(TokenStream& tokens)
                          "start and/or size parameters to 'file' were specified\n";
             }
         } else {
-            return LoadPNG(data.data(), data.size(), filenameToken, filename);
+            return LoadPNG(data->data(), data->size(), filenameToken, filename);
         }
     }
 #endif // CLTB_USE_LIBPNG
 
-    return std::make_unique<FileDataObject>(std::string(filename), std::move(data));
+    return data;
 }
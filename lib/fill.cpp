@@ -0,0 +1,88 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <iostream>
+
+#include "driver.hpp"
+#include "error.hpp"
+#include "object_cl.hpp"
+#include "object_data.hpp"
+#include "testbench.hpp"
+#include "token.hpp"
+
+using namespace CLTestbench;
+
+void Testbench::fill(Object& object, const Object& patternObject, const Token& patternToken, std::size_t offset,
+                     std::size_t size)
+{
+    auto& buffer = static_cast<MemoryObject&>(object);
+    const auto* pattern = dynamic_cast<const DataObject*>(&patternObject);
+    if (!pattern) throw CommandError("Expected a data object for the fill pattern.", patternToken);
+
+    // clEnqueueFillBuffer only accepts the sizes of OpenCL C scalar and vector types.
+    const std::size_t patternSize = pattern->size();
+    if (patternSize == 0 || patternSize > 128 || (patternSize & (patternSize - 1)) != 0) {
+        throw CommandError([=](std::ostream& out) {
+            out << "The fill pattern is " << patternSize << " bytes, but must be 1, 2, 4, 8, 16, 32, 64 or 128.";
+        }, patternToken);
+    }
+    if (offset % patternSize != 0 || size % patternSize != 0) {
+        throw CommandError([=](std::ostream& out) {
+            out << "The filled offset and size must be multiples of the " << patternSize << "-byte pattern.";
+        }, patternToken);
+    }
+
+    // Filling a whole buffer replaces the data it has yet to upload.
+    if (offset == 0 && size == buffer.data.mBufferSize && !buffer.data.mParent) buffer.data.mPendingData.reset();
+    else upload(buffer);
+    mDriver->fillBuffer(buffer, pattern->data(), patternSize, offset, size);
+}
+
+void Testbench::executeFill(TokenStream& tokens)
+{
+    if (!mDriver)
+        throw CommandError("An OpenCL implementation must be loaded for a 'fill' command.");
+
+    Token bufferToken = tokens.current();
+    auto object = evaluate(tokens);
+    auto* buffer = dynamic_cast<MemoryObject*>(object.get());
+    if (!buffer || buffer->data.mDescriptor.image_width != 0)
+        throw CommandError("Expected a buffer object.", bufferToken);
+
+    Token patternToken = tokens.current();
+    if (patternToken.mType == Token::End) throw CommandError("Expected a fill pattern.", patternToken);
+    auto pattern = evaluate(tokens);
+
+    std::size_t offset = 0;
+    std::size_t size = buffer->data.mBufferSize;
+    if (tokens) {
+        Token offsetToken = tokens.consume();
+        if (offsetToken.mType != Token::Constant) throw CommandError("Expected offset constant.", offsetToken);
+        offset = tokens.parseConstant<std::size_t>(offsetToken);
+        if (offset > buffer->data.mBufferSize) throw CommandError("Offset exceeds the buffer size.", offsetToken);
+        size = buffer->data.mBufferSize - offset;
+
+        if (tokens) {
+            Token sizeToken = tokens.consume();
+            if (sizeToken.mType != Token::Constant) throw CommandError("Expected length constant.", sizeToken);
+            size = tokens.parseConstant<std::size_t>(sizeToken);
+            if (offset + size > buffer->data.mBufferSize)
+                throw CommandError("Length exceeds the buffer size.", sizeToken);
+        }
+    }
+    if (tokens && mOptions.verbose) *mOut << "Trailing tokens on 'fill' command ignored.\n";
+
+    fill(*buffer, *pattern, patternToken, offset, size);
+}
@@ -35,16 +35,27 @@ void GenericHelp(std::ostream& out)
            " * select plaform|device N   - Selects a platform and device to use.\n"
            "                               Defaults to the first platform/device found (N is 0).\n"
            "                               Ommitting argument shows currently selected platform/device.\n"
+           " * select devices N...|all   - Selects several devices of the platform, for split runs.\n"
            " * VAR = EXPRESSION          - Defines a variable constructed with an evaluated expression.\n"
            "                               Use 'help expression' to list supported expressions.\n"
            " * release VAR               - Clears a defined variable, releasing associated memory.\n"
            " * run                       - Runs a kernel with the given arguments.\n"
+           " * rerun [KERNEL] [COUNT]    - Runs the last launch, or that of a kernel, again.\n"
            " * list                      - Lists all defined variables.\n"
            " * save                      - Saves a data object to disk.\n"
            " * script                    - Runs commands from a script file.\n"
-           " * flush                     - Flushes the queued commands.\n"
-           " * wait                      - Blocks until all pending OpenCL commands finish.\n"
+           " * flush [QUEUES...]         - Flushes the queued commands of all, or the given, queues.\n"
+           " * wait [EVENTS|QUEUES...]   - Blocks until all pending OpenCL commands finish, or only\n"
+           "                               the given events and the commands of the given queues.\n"
+           " * wait jobs                 - Blocks until the background 'save' jobs finish.\n"
+           " * jobs                      - Lists the background 'save' jobs.\n"
            " * clone                     - Clones a CL Object.\n"
+           " * stats                     - Shows device timings of profiled commands.\n"
+           " * bench                     - Runs a kernel repeatedly and reports its timings.\n"
+           " * tune                      - Finds the fastest local size for a kernel launch.\n"
+           " * fill                      - Fills a buffer with a repeated pattern.\n"
+           " * migrate                   - Migrates memory objects to a device or the host.\n"
+           " * trace start FILE|stop     - Records a timeline of commands and device activity.\n"
            "Use 'help command' for command-specific information.  Use 'help expression' for a list of\n"
            "functions available for object construction.\n";
 }
@@ -81,14 +92,27 @@ void HelpForExpressionKernel(std::ostream& out)
 
 void HelpForExpressionBuffer(std::ostream& out)
 {
-    out << "buffer(DATA [, START[, LEN]])\n"
+    out << "buffer(DATA [, START[, LEN]] [, FLAGS...])\n"
            "Creates an OpenCL buffer object from DATA.\n"
            "The size of the buffer is calculated from the given start and length offsets.\n"
            "By default, the entire data is used.\n"
            "The second form of the command:\n"
-           "    buffer(SIZE)\n"
-           "Will create a buffer with the given size in bytes.  The buffer will be uninitialised.\n"
-           "In both forms of the command, the buffer will be created with read-write permissions.\n";
+           "    buffer(SIZE [, PATTERN] [, FLAGS...])\n"
+           "Will create a buffer with the given size in bytes.  The buffer will be uninitialised,\n"
+           "unless a PATTERN data object is given, such as 'float(0)'.  The buffer is then filled\n"
+           "with it on the device; see 'help fill'.\n"
+           "By default, the buffer will be created with read-write permissions.  FLAGS change this:\n"
+           " * read_only      - CL_MEM_READ_ONLY.\n"
+           " * write_only     - CL_MEM_WRITE_ONLY.\n"
+           " * host_no_access - CL_MEM_HOST_NO_ACCESS.  The buffer cannot be saved.\n"
+           " * alloc_host     - CL_MEM_ALLOC_HOST_PTR.\n"
+           " * use_host       - CL_MEM_USE_HOST_PTR.  The buffer wraps DATA itself when it is\n"
+           "                    page-aligned, such as a file() loaded from its start; otherwise\n"
+           "                    it wraps an aligned copy.  A wrapped DATA object reflects what\n"
+           "                    kernels write to the buffer.\n"
+           "Buffers using host memory are saved by mapping them, rather than reading a copy.\n"
+           "Example:\n"
+           "    input = buffer(file(\"data.bin\"), use_host, read_only)\n";
 }
 
 void HelpForExpressionImage(std::ostream& out)
@@ -140,6 +164,8 @@ void HelpForExpressionFile(std::ostream& out)
            "by the read offset.\n"
            "If appropriate support has been enabled, the contents of the file will be decoded\n"
            "after loading, such as when loading image files.\n"
+           "The file is mapped into memory rather than copied, so only the pages which are used\n"
+           "are read.  The file must not be truncated while the object exists.\n"
            "Example:\n"
            "    data = file(\"data.bin\")\n"
            "    buffer = buffer(data)\n"
@@ -181,13 +207,61 @@ void HelpForExpressionClone(std::ostream& out)
            "be added in the future if/when the need arises.\n";
 }
 
+void HelpForExpressionSlice(std::ostream& out)
+{
+    out << "slice(BUFFER, OFFSET [, LEN])\n"
+           "Creates a sub-buffer over LEN bytes of BUFFER, starting at OFFSET, with clCreateSubBuffer.\n"
+           "By default, the slice extends to the end of BUFFER.\n"
+           "No memory is allocated or copied: the slice shares its contents with BUFFER, which\n"
+           "is kept alive for as long as the slice.  OFFSET must be a multiple of the device's\n"
+           "CL_DEVICE_MEM_BASE_ADDR_ALIGN.  Slices of slices are created from the original buffer.\n"
+           "Example:\n"
+           "    data = buffer(file(\"data.bin\"))\n"
+           "    run k((1024), slice(data, 0, 4096))\n"
+           "    run k((1024), slice(data, 4096, 4096))\n";
+}
+
+void HelpForExpressionSVM(std::ostream& out)
+{
+    out << "svm(SIZE [, FLAGS...])\n"
+           "svm(DATA [, FLAGS...])\n"
+           "Allocates SIZE bytes of shared virtual memory with clSVMAlloc.  The allocation is\n"
+           "uninitialised, unless created from DATA.  It is passed to kernels as a pointer, with\n"
+           "clSetKernelArgSVMPointer, and can be saved and cloned like a buffer.\n"
+           "FLAGS select the kind of allocation, which the device must support:\n"
+           " * coarse  - A coarse-grained buffer.  This is the default.  The host maps it to access it.\n"
+           " * fine    - CL_MEM_SVM_FINE_GRAIN_BUFFER.  The host accesses it without mapping.\n"
+           " * atomics - CL_MEM_SVM_ATOMICS, for fine-grained allocations.\n"
+           "An allocation is freed as soon as it is released, so wait for the kernels using it first.\n"
+           "Example:\n"
+           "    nodes = svm(file(\"tree.bin\"), fine)\n"
+           "    run walk((4096), nodes)\n";
+}
+
+void HelpForExpressionQueue(std::ostream& out)
+{
+    out << "queue([PROPERTIES...])\n"
+           "Creates a command queue on the selected device, besides the Testbench's default queue.\n"
+           "Kernels are run on it with 'run ... on QUEUE'; see 'help run'.  PROPERTIES are:\n"
+           " * out_of_order - CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE.  Commands may run concurrently,\n"
+           "                  unless ordered with 'after'.\n"
+           " * profiling    - CL_QUEUE_PROFILING_ENABLE.  Runs are recorded for 'stats'.\n"
+           "Example:\n"
+           "    compute = queue(out_of_order, profiling)\n"
+           "    e1 = run producer((1024),, data) on compute\n"
+           "    e2 = run other((1024),, more) on compute\n"
+           "    run consumer((1024),, data) on compute after e1\n"
+           "    wait compute\n";
+}
+
 void HelpForExpression(std::ostream& out, TokenStream& tokens)
 {
     if (tokens) {
         Token subexpr = tokens.consume();
         IStringView command = tokens.getTokenText(subexpr);
         const std::initializer_list<std::string_view> commands {
-            "program", "kernel", "buffer", "image", "file", "type", "clone", "binary"
+            "program", "kernel", "buffer", "image", "file", "type", "clone", "binary", "slice", "svm",
+            "queue"
         };
 
         switch (command.autocomplete(commands)) {
@@ -199,6 +273,9 @@ void HelpForExpression(std::ostream& out, TokenStream& tokens)
         case 5: HelpForExpressionType(out); return;
         case 6: HelpForExpressionClone(out); return;
         case 7: HelpForExpressionBinary(out); return;
+        case 8: HelpForExpressionSlice(out); return;
+        case 9: HelpForExpressionSVM(out); return;
+        case 10: HelpForExpressionQueue(out); return;
         case IStringView::ambiguous:
             out << "Ambiguous argument for help expression '" << command << "'\n";
             return;
@@ -214,7 +291,12 @@ void HelpForExpression(std::ostream& out, TokenStream& tokens)
            " * program(SOURCE [, OPTIONS])      - Creates a CL program from SOURCE with given OPTIONS.\n"
            " * kernel(PROGRAM, NAME)            - Creates kernel NAME from from PROGRAM.\n"
            " * buffer(DATA [, START[, LEN]])    - Creates a memory buffer from DATA, with specified offset and length.\n"
-           " * buffer(SIZE)                     - Creates a memory buffer with specified SIZE.\n"
+           " * buffer(SIZE [, PATTERN])         - Creates a memory buffer with specified SIZE, optionally filled.\n"
+           "                                      Both forms accept memory flags; see 'help expression buffer'.\n"
+           " * slice(BUFFER, OFFSET [, LEN])    - Creates a sub-buffer view of a region of BUFFER.\n"
+           " * svm(SIZE [, FLAGS])              - Allocates shared virtual memory.\n"
+           " * queue([PROPERTIES])              - Creates a command queue.\n"
+           " * run KERNEL(...) [on Q] [after E] - Runs a kernel and returns its event; see 'help run'.\n"
            " * image(data[, PROPERTIES])        - Creates an image object from the provided data buffer.\n"
            " * file(FILENAME [, START[, LEN]])  - Loads the contents of this file,\n"
            "                                      optionally specifying start offset and length.\n"
@@ -239,6 +321,47 @@ void HelpForSet(std::ostream& out)
            " * caret      - Controls output of diagnostic caret.  Default ON.\n"
            " * block      - Sets driver commands as blocking. Default ON.\n"
            "                See IMPORTANT notes below!\n"
+           " * profile    - Records device timings of enqueued commands.  Default OFF.\n"
+           "                See 'help stats'.\n"
+           " * programcache - Stores binaries of programs built from source, and loads\n"
+           "                them instead of compiling when the source, build options,\n"
+           "                platform, device and driver version match.  Default OFF.\n"
+           "                Headers included by the source, and the -I directories they\n"
+           "                are found in, aren't compared, so a cached binary is still\n"
+           "                loaded after a header changes; use 'set programcache clear'.\n"
+           "                Binaries are kept in $XDG_CACHE_HOME/cltb/programs, or in\n"
+           "                ~/.cache/cltb/programs.  'set programcache clear' removes them.\n"
+           "                'set' shows the programs loaded from the cache (hits), and\n"
+           "                those built from source instead (misses).\n"
+           " * transfer   - 'map' or 'copy'.  With 'map', data is moved between the host and\n"
+           "                buffers or images by mapping them instead of with read and write\n"
+           "                commands, if the device reports CL_DEVICE_HOST_UNIFIED_MEMORY.\n"
+           "                Mapped transfers always block.  Default 'copy'.\n"
+           " * asyncbuild - Builds programs from source on worker threads, so that 'program'\n"
+           "                returns immediately.  The first 'kernel' or 'save' using the program\n"
+           "                waits for its build, and reports any build failure.  Default OFF.\n"
+           " * bufferpool - ON, OFF or a number of bytes.  Keeps released buffers, and reuses\n"
+           "                them for new buffers with the same flags instead of creating them.\n"
+           "                Pooled buffers are rounded up to one of four sizes per power of two,\n"
+           "                and their initial contents are those left by their previous use.\n"
+           "                At most the given bytes (256 MiB with ON) are kept idle.  Buffers\n"
+           "                using host memory aren't pooled.  See 'info memory'.  Default OFF.\n"
+           " * lazyupload - Defers writing the data of buffer(DATA) to the device until the\n"
+           "                buffer is first used by 'run', 'bind', 'save', 'clone', 'fill' or\n"
+           "                'migrate', so that data which is never used isn't uploaded.  The\n"
+           "                buffer keeps the data object until then.  Buffers using host memory\n"
+           "                or created with 'host_no_access' are still written at once.\n"
+           "                Default OFF.\n"
+           " * streamchunk - A number of bytes, or OFF.  buffer(DATA) writes data larger than\n"
+           "                this in chunks, through two pinned staging buffers, so that reading\n"
+           "                the data (such as a file) overlaps with the transfer.  'save' reads\n"
+           "                larger buffers back in chunks likewise, writing each to the file while\n"
+           "                the next is read.  Streamed transfers always block.  'stats' shows\n"
+           "                their throughput.  Default 64 MiB.\n"
+           " * asyncsave  - 'save' of a buffer returns at once, while a worker thread reads it in\n"
+           "                chunks and writes the file.  The buffer is kept alive until then.\n"
+           "                See 'help jobs'.  Images, buffers in host memory, SVM allocations and\n"
+           "                other objects are still saved at once.  Default OFF.\n"
            "Accepted values for boolean arguments are (case insensitive):\n"
            " * ON         - 'true', 'yes', 'on', '1', 'y', t'\n"
            " * OFF        - 'false', 'no', 'off', '0', 'n', f'\n"
@@ -258,7 +381,7 @@ void HelpForSet(std::ostream& out)
            " data = int(1, 2, 3)\n"
            " obj = buffer(data)\n"
            "\n"
-           "Further to the above, the CLTestbench uses an in-order queue, so commands\n"
+           "Further to the above, the CLTestbench uses an in-order default queue, so commands\n"
            "will always execute in the same order as they are submitted.\n"
            "Remember to use the 'wait' command to block until all commands are finished.\n"
            "Kernel enqueue commands *always* execute as non-blocking.  This is because\n"
@@ -272,39 +395,137 @@ void HelpForSet(std::ostream& out)
 void HelpForSave(std::ostream& out)
 {
     out << "save OBJECT FILE\nWrites a the given OBJECT to a file.\n"
-           "If OBJECT is a CL Buffer, an implicit READ is performed.\n"
+           "If OBJECT is a CL Buffer, an implicit READ is performed.  Large buffers are read\n"
+           "and written in chunks; see 'set streamchunk'.\n"
            "If OBJECT is a CL Image, an implicit READ is performed.\n"
-           "If OBJECT is a CL Program, a program binary is generated.\n";
+           "If OBJECT is a CL Program, a program binary is generated.\n"
+           "With 'set asyncsave on', buffers are saved in the background; see 'help jobs'.\n";
     return;
 }
 
 void HelpForRun(std::ostream& out)
 {
-    out << "run KERNEL((SIZE), [(LOCAL_SIZE),] ARGS...)\nRuns a kernel.'\n"
+    out << "run KERNEL((SIZE), [(LOCAL_SIZE)], [(OFFSET),] ARGS...) [on QUEUE] [after EVENTS...]\n"
+           "Runs a kernel.\n"
            " * KERNEL       must evaluate to a OpenCL Kernel object.\n"
            " * (SIZE)       must contain up to 3 constants, specifying the enqueue size.\n"
            " * (LOCAL_SIZE) if specified, must contain 3 constants for local size.\n"
+           "                If omitted, the local size found by 'tune' for this kernel, global\n"
+           "                size and device is used.  Otherwise, the implementation chooses.\n"
+           " * (OFFSET)     if specified, must contain up to 3 constants for the global work\n"
+           "                offset.  The local size may be left empty: k((64),,(128), a)\n"
            " * ARGS         must evaluate to CL Memory objects, given as kernel arguments.\n"
            "The arguments are bound to the kernel.  Subsequent runs of the same kernel with\n"
            "the same arguments may omit one or more of ARG.  Repeating a run of a kernel\n"
-           "this way may cause user-after-free errors if the run command used temporary\n"
-           "kernel argument objects; that is, they were constructed while evaluating the\n"
+           "this way fails if a bound memory object was released since, as are temporary\n"
+           "kernel argument objects; that is, those constructed while evaluating the\n"
            "'run' command.  Any of these ARGS may also be constants.\n"
+           "Constants are converted to the argument's type if the program was built with\n"
+           "-cl-kernel-arg-info; otherwise they need a type, as in 'uint(42)'.  For a\n"
+           "__local pointer argument, the constant is the size of the local memory in bytes.\n"
+           "'info kernel KERNEL' lists the argument types.\n"
+           "Arguments that are bound to the same value as before aren't set again.  Binding\n"
+           "doesn't keep memory objects alive, so 'release' frees them.\n"
            "IMPORTANT:\n"
            "The kernel enqueue, if successful, will run in parallel with the Testbench.\n"
            "This should not be an issue because the Testbench uses an in-order queue,\n"
            "so any commands issues after will implicitly wait for the kernel to finish.\n"
-           "Use the 'wait' Testbench command to block until execution finishes.\n";
+           "Use the 'wait' Testbench command to block until execution finishes.\n"
+           "\n"
+           "The kernel runs on the default queue, unless another is given with 'on QUEUE'.\n"
+           "Commands on different queues, or an out-of-order queue, may run concurrently.\n"
+           "With 'after', the kernel waits for the given events.  A run's event is kept by\n"
+           "assigning it to a variable:\n"
+           "    e1 = run k((16),, a) on q1\n"
+           "    run k2((16),, a) on q2 after e1\n"
+           "    wait e1\n"
+           "See 'help expression queue'.\n"
+           "\n"
+           "With 'split [WEIGHTS...]', the first dimension of the global range is split across\n"
+           "the devices chosen with 'select devices', in proportion to the WEIGHTS given for\n"
+           "each device, or evenly.  Each device runs its part on its own queue, with a global\n"
+           "offset, and the parts are recorded separately for 'stats'.  Parts hold whole\n"
+           "work-groups when a local size is given.  Example, with the first of two devices\n"
+           "given three quarters of the range:\n"
+           "    select devices 0 1\n"
+           "    run k((4096), (64), a, b) split 3 1\n";
     return;
 }
 
+void HelpForMigrate(std::ostream& out)
+{
+    out << "migrate OBJECTS... to DEVICE|host\n"
+           "Migrates memory objects, with clEnqueueMigrateMemObjects, to one of the devices chosen\n"
+           "with 'select devices', numbered from 0 in the order they were given, or to the host.\n"
+           "OpenCL migrates objects implicitly when used; this makes the transfer explicit, so\n"
+           "that it can be timed separately, or overlapped with other work.\n"
+           "Example:\n"
+           "    select devices 0 1\n"
+           "    migrate a b to 1\n";
+}
+
+void HelpForRerun(std::ostream& out)
+{
+    out << "rerun [KERNEL] [COUNT]\n"
+           "Repeats the last 'run' command, or the last run of KERNEL, COUNT times (default 1).\n"
+           "Only the sizes, the queue, the events waited for and the split are replayed.  The\n"
+           "arguments aren't; the kernel runs with its currently bound arguments, including\n"
+           "those bound by later 'bind' or 'run' commands.  It fails if one of them, or the\n"
+           "kernel, queue or events of the launch, was released.\n"
+           "Example:\n"
+           "    run k((1024),, a, b)\n"
+           "    rerun k 100\n";
+}
+
+void HelpForTrace(std::ostream& out)
+{
+    out << "trace start FILE\n"
+           "trace stop\n"
+           "Records a timeline of the testbench commands and of the device commands they enqueue,\n"
+           "and writes it to FILE in the Chrome Trace Event format when stopped.  The file can be\n"
+           "loaded by chrome://tracing or https://ui.perfetto.dev to spot idle time between\n"
+           "commands.  Profiling is enabled while tracing.  Each queue gets its own track.\n"
+           "Device times are mapped to the host clock with clGetDeviceAndHostTimer, which is\n"
+           "sampled when queues are created and about once a second while profiling, correcting\n"
+           "for clock drift.  Without it, device times are aligned by the time at which each\n"
+           "command was enqueued, so they may be off by the enqueue overhead.\n"
+           "Launches on queues created without profiling, and the launches of 'bench' and 'tune',\n"
+           "aren't recorded.\n"
+           "Without arguments, shows whether a trace is being recorded.\n";
+}
+
+void HelpForJobs(std::ostream& out)
+{
+    out << "jobs\n"
+           "wait jobs\n"
+           "With 'set asyncsave on', 'save' of a buffer starts a job, which reads the buffer in\n"
+           "chunks on a worker thread, on a queue of its own, and writes each chunk to the file\n"
+           "as the next one is read; see 'set streamchunk'.  The next commands overlap with the\n"
+           "job.  Those enqueued on the default queue run once the buffer is read, so the file\n"
+           "holds the data at the time of the 'save'; commands on other queues must wait for the\n"
+           "job.  The job keeps the buffer alive, even if it's released.  Its reads aren't\n"
+           "recorded for 'stats'.  Only buffers in device memory are saved in the background.\n"
+           "The worker waits for each chunk's read rather than using an event callback, since\n"
+           "it reuses the chunk's staging buffer once the chunk is written.\n"
+           "'jobs' lists the jobs which are writing, and those which finished since the last\n"
+           "'jobs', reporting their errors.  'wait jobs' blocks until every job finishes, and\n"
+           "fails if any of them did.  Loading another driver or selecting devices also waits\n"
+           "for them.\n";
+}
+
 void HelpForInfo(std::ostream& out)
 {
     out << "Displays information on the current state of the testbench.\n"
            "Available operands:\n"
            " * platforms - Displays list of available platforms.\n"
-           " * devices   - Displays list of available devices.\n"
-           " * lib       - Displays driver library information.\n";
+           " * devices   - Displays the available devices and their capabilities.\n"
+           "               'info devices json' prints them as JSON, to compare hosts offline.\n"
+           " * lib       - Displays driver library information.\n"
+           " * kernel K  - Displays the arguments of kernel K, if the program was built\n"
+           "               with -cl-kernel-arg-info, and how many binds were skipped.\n"
+           " * memory    - Displays the buffers and images holding device memory, their total\n"
+           "               against CL_DEVICE_GLOBAL_MEM_SIZE, and the most held at once.\n"
+           "               Buffers and images that would exceed the device's limits aren't created.\n";
     return;
 }
 
@@ -318,12 +539,70 @@ void HelpForScript(std::ostream& out)
            "disabled (see 'set echo').\n";
 }
 
+void HelpForStats(std::ostream& out)
+{
+    out << "stats [clear]\n"
+           "Shows the device timings of every command enqueued while profiling was\n"
+           "enabled with 'set profile on'.  This includes kernel runs, as well as buffer\n"
+           "and image reads, writes and copies.  Showing the timings will wait for the\n"
+           "profiled commands to finish.\n"
+           "When the device clock can be correlated with the host's (clGetDeviceAndHostTimer),\n"
+           "the start times of all devices are on the host clock, relative to the first command.\n"
+           "Enabling profiling recreates the command queue with CL_QUEUE_PROFILING_ENABLE.\n"
+           "The bytes moved between the host and memory objects by read and write commands\n"
+           "(copy), and by mappings (map), are also shown.  These are counted even when\n"
+           "profiling is disabled.\n"
+           "Use 'stats clear' to discard the recorded timings and transfer counts.\n";
+}
+
+void HelpForBench(std::ostream& out)
+{
+    out << "bench KERNEL((SIZE), [(LOCAL_SIZE),] ARGS...) [ITERATIONS [WARMUP]]\n"
+           "Runs a kernel ITERATIONS times (default 100), after WARMUP untimed runs (default 10).\n"
+           "The kernel and its arguments are given as with the 'run' command.  The arguments\n"
+           "are bound once, before the first launch.\n"
+           "Each launch waits for the previous one to finish.  The minimum, median, mean,\n"
+           "95th and 99th percentiles, and standard deviation are reported for:\n"
+           " * Device - the kernel execution time, as reported by the OpenCL profiling events.\n"
+           " * Host   - the time from enqueueing the kernel until the host observes its completion.\n"
+           "Without a LOCAL_SIZE, the one found by 'tune' is used, as by 'run'.\n"
+           "Profiling is enabled for the duration of the benchmark, and the launches are not\n"
+           "recorded for the 'stats' command.\n";
+}
+
+void HelpForTune(std::ostream& out)
+{
+    out << "tune KERNEL((SIZE), ARGS...) [ITERATIONS]\n"
+           "Benchmarks the kernel with every candidate local size, and selects the one with the\n"
+           "lowest median device time.  Each candidate runs ITERATIONS times (default 20).\n"
+           "The kernel and its arguments are given as with the 'run' command, without a local size.\n"
+           "Candidate local sizes divide the global size in every dimension, are within the\n"
+           "device and kernel work-group limits, and are either powers of two or multiples of\n"
+           "the kernel's preferred work-group size multiple.\n"
+           "The selected size is saved in the 'localsizes' file of the CLTestbench cache directory\n"
+           "($XDG_CACHE_HOME/cltb, or ~/.cache/cltb), keyed on the device name, driver version,\n"
+           "kernel name and global size.  Later 'run' commands matching these which don't give\n"
+           "a local size will use it.\n";
+}
+
+void HelpForFill(std::ostream& out)
+{
+    out << "fill BUFFER PATTERN [OFFSET [LEN]]\n"
+           "Fills BUFFER with PATTERN repeated, on the device, with clEnqueueFillBuffer.\n"
+           "PATTERN must be a data object of 1, 2, 4, 8, 16, 32, 64 or 128 bytes, and OFFSET and LEN\n"
+           "multiples of its size.  By default the whole buffer is filled.\n"
+           "Buffers can also be created filled, with 'buffer(SIZE, PATTERN)'.\n"
+           "Example:\n"
+           "    fill output float(0)\n"
+           "    fill output uint(0xdeadbeef) 1024 256\n";
+}
+
 void HelpForBind(std::ostream& out)
 {
     out << "bind KERNEL ARGNO OBJECT [OBJECT ...]\n"
            "Binds kernel arguments.\n"
            "The objects are set as sequential kernel arguments,\n"
-           "starting at ARGNO.\n";
+           "starting at ARGNO.  Constants are converted as for 'run'.\n";
 }
 } // namespace
 
@@ -338,7 +617,8 @@ void Testbench::executeHelp(TokenStream& tokens)
     IStringView command = tokens.getTokenText(next);
     const std::initializer_list<std::string_view> commands{
         "help", "info", "set", "expression",
-        "save", "run", "script", "bind"
+        "save", "run", "script", "bind", "stats", "bench", "tune",
+        "fill", "migrate", "rerun", "trace", "jobs"
     };
 
     switch (command.autocomplete(commands)) {
@@ -352,6 +632,14 @@ void Testbench::executeHelp(TokenStream& tokens)
     case 5: HelpForRun(*mOut); break;
     case 6: HelpForScript(*mOut); break;
     case 7: HelpForBind(*mOut); break;
+    case 8: HelpForStats(*mOut); break;
+    case 9: HelpForBench(*mOut); break;
+    case 10: HelpForTune(*mOut); break;
+    case 11: HelpForFill(*mOut); break;
+    case 12: HelpForMigrate(*mOut); break;
+    case 13: HelpForRerun(*mOut); break;
+    case 14: HelpForTrace(*mOut); break;
+    case 15: HelpForJobs(*mOut); break;
     case IStringView::ambiguous:
         *mOut << "Ambiguous argument for help '" << command << "'\n";
         break;
@@ -167,5 +167,6 @@ std::shared_ptr<Object> Testbench::evaluateImage(TokenStream& tokens)
         }, objectToken);
     }
 
+    checkAllocation(imageSize, objectToken);
     return mDriver->createImage(format, desc, data->data());
 }
@@ -13,15 +13,121 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 
+#include "bufferpool.hpp"
 #include "driver.hpp"
+#include "error.hpp"
 #include "istringview.hpp"
+#include "memoryledger.hpp"
+#include "object_cl.hpp"
+#include "object_data.hpp"
+#include "table.hpp"
 #include "testbench.hpp"
 #include "token.hpp"
 
 using namespace CLTestbench;
 
+namespace
+{
+std::string_view AddressName(cl_kernel_arg_address_qualifier address)
+{
+    switch (address) {
+    case CL_KERNEL_ARG_ADDRESS_GLOBAL: return "global";
+    case CL_KERNEL_ARG_ADDRESS_LOCAL: return "local";
+    case CL_KERNEL_ARG_ADDRESS_CONSTANT: return "constant";
+    default: return "private";
+    }
+}
+
+std::string MemoryFlagNames(cl_mem_flags flags)
+{
+    std::string names = (flags & CL_MEM_READ_ONLY) ? "read_only" : (flags & CL_MEM_WRITE_ONLY) ? "write_only"
+                                                                                                : "read_write";
+    if (flags & CL_MEM_USE_HOST_PTR) names += ", use_host";
+    if (flags & CL_MEM_ALLOC_HOST_PTR) names += ", alloc_host";
+    if (flags & CL_MEM_HOST_NO_ACCESS) names += ", host_no_access";
+    return names;
+}
+
+/// The fraction as a percentage, or "-" if the limit is unknown.
+std::string Percentage(uint64_t bytes, uint64_t limit)
+{
+    if (limit == 0) return "-";
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << 100.0 * static_cast<double>(bytes) / static_cast<double>(limit)
+        << '%';
+    return out.str();
+}
+
+std::string_view AccessName(cl_kernel_arg_access_qualifier access)
+{
+    switch (access) {
+    case CL_KERNEL_ARG_ACCESS_READ_ONLY: return "read_only";
+    case CL_KERNEL_ARG_ACCESS_WRITE_ONLY: return "write_only";
+    case CL_KERNEL_ARG_ACCESS_READ_WRITE: return "read_write";
+    default: return "-";
+    }
+}
+} // namespace
+
+void Testbench::showMemory()
+{
+    const MemoryLedger& ledger = mDriver->getMemoryLedger();
+    const auto& capabilities = mDriver->getDeviceCapabilities();
+    const auto allocations = ledger.allocations();
+    if (!allocations.empty()) {
+        // Memory objects without a name are still held, such as by bound kernel arguments.
+        std::vector<std::string> names(allocations.size()), cells;
+        cells.reserve(allocations.size() * 3);
+        for (const auto& [name, object] : mObjects) {
+            auto* memory = dynamic_cast<MemoryObject*>(object.get());
+            if (!memory) continue;
+            for (std::size_t i = 0; i < allocations.size(); ++i) {
+                if (allocations[i].mId != memory->data.mLedgerRecord.id()) continue;
+                if (!names[i].empty()) names[i] += ", ";
+                names[i] += name;
+            }
+        }
+        Util::Table table(5, allocations.size());
+        table.setHeader({"Name", "Type", "Bytes", "Flags", "Of max alloc"});
+        for (std::size_t i = 0; i < allocations.size(); ++i) {
+            if (names[i].empty()) names[i] = "-";
+            table[i][0] = names[i];
+            table[i][1] = allocations[i].mImage ? "image" : "buffer";
+            cells.push_back(std::to_string(allocations[i].mSize));
+            table[i][2] = cells.back();
+            cells.push_back(MemoryFlagNames(allocations[i].mFlags));
+            table[i][3] = cells.back();
+            cells.push_back(Percentage(allocations[i].mSize, capabilities.mMaxMemAllocSize));
+            table[i][4] = cells.back();
+        }
+        *mOut << table;
+    }
+
+    const uint64_t live = ledger.liveBytes();
+    *mOut << "Live: " << live << " bytes in " << allocations.size() << " memory objects";
+    if (capabilities.mGlobalMemSize != 0)
+        *mOut << ", " << Percentage(live, capabilities.mGlobalMemSize) << " of " << capabilities.mGlobalMemSize
+              << " bytes of global memory";
+    *mOut << ".\nHigh watermark: " << ledger.highWatermark() << " bytes.\n";
+    if (capabilities.mMaxMemAllocSize != 0)
+        *mOut << "Maximum allocation size: " << capabilities.mMaxMemAllocSize << " bytes.\n";
+    if (const BufferPool* pool = mDriver->getBufferPool(); pool && pool->isEnabled()) {
+        // Idle buffers still hold device memory, but are not in the ledger.
+        const auto stats = pool->getStats();
+        *mOut << "Buffer pool: " << pool->getIdleBytes() << " bytes idle in " << pool->getIdleCount()
+              << " buffers, of " << pool->getLimit() << ".  " << stats.mHits << " hits, " << stats.mMisses
+              << " misses (" << Percentage(stats.mHits, stats.mHits + stats.mMisses) << " hit rate), "
+              << stats.mEvictions << " evicted.\n";
+    }
+}
+
 void Testbench::executeInfo(TokenStream& tokens)
 {
     IStringView command = tokens.getTokenText(tokens.current());
@@ -30,7 +136,7 @@ void Testbench::executeInfo(TokenStream& tokens)
         return;
     }
 
-    auto match = command.autocomplete({"library", "platforms", "devices"});
+    auto match = command.autocomplete({"library", "platforms", "devices", "kernel", "memory"});
     switch (match) {
     case 0: {
         if (mDriver) {
@@ -63,12 +169,79 @@ void Testbench::executeInfo(TokenStream& tokens)
             *mOut << "No OpenCL library loaded.\n";
             return;
         }
+        tokens.advance();
+        Token formatToken = tokens.consume();
+        const bool json = formatToken.mType == Token::String && tokens.getTokenText(formatToken) == "json";
+        if (!json && formatToken.mType != Token::End)
+            throw CommandError("Expected 'json' or nothing for 'info devices'.", formatToken);
+
         auto devices = mDriver->getDeviceIDs(mDriver->mPlatform);
+        auto selected = mDriver->getDevices();
+        auto isSelected = [&](cl_device_id device) {
+            return std::find(selected.begin(), selected.end(), device) != selected.end();
+        };
+        if (json) {
+            // One object per device, so that hosts can be compared offline.
+            *mOut << "[\n";
+            for (unsigned i = 0; i < devices.size(); ++i) {
+                *mOut << "  {\"index\": " << i << ", \"selected\": " << (isSelected(devices[i]) ? "true" : "false")
+                      << ", \"capabilities\": ";
+                WriteJSON(*mOut, mDriver->queryDeviceCapabilities(devices[i]));
+                *mOut << (i + 1 < devices.size() ? "},\n" : "}\n");
+            }
+            *mOut << "]\n";
+            break;
+        }
         for (unsigned i = 0; i < devices.size(); ++i) {
             *mOut << '[' << i << ']';
-            if (devices[i] == mDriver->mDevice) *mOut << " (selected)";
-            *mOut << " =\n" << mDriver->getDeviceInfo(devices[i]) << '\n';
+            if (isSelected(devices[i])) *mOut << " (selected)";
+            *mOut << " =\n";
+            if (devices[i] == mDriver->mDevice) *mOut << mDriver->getDeviceCapabilities() << '\n';
+            else *mOut << mDriver->queryDeviceCapabilities(devices[i]) << '\n';
+        }
+        break;
+    }
+    case 3: {
+        tokens.advance();
+        if (!tokens) throw CommandError("Expected kernel object for 'info kernel'.");
+        Token kernelToken = tokens.current();
+        auto kernelObj = evaluate(tokens);
+        auto* kernel = dynamic_cast<KernelObject*>(kernelObj.get());
+        if (!kernel) throw CommandError("Expected kernel object.", kernelToken);
+
+        *mOut << "Argument binds: " << kernel->data.mArgSetsIssued << " set, " << kernel->data.mArgSetsSkipped
+              << " skipped as unchanged.\n";
+        const auto& args = kernel->data.mArgs;
+        if (args.empty()) {
+            *mOut << "No argument information.  Build the program with -cl-kernel-arg-info for it.\n";
+            return;
+        }
+        // The table only keeps views of the strings.
+        std::vector<std::string> indices, sizes;
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            indices.push_back(std::to_string(i));
+            const std::size_t size = ScalarTypeSize(args[i].mTypeName);
+            sizes.push_back(size ? std::to_string(size) : "-");
+        }
+        Util::Table table(6, args.size());
+        table.setHeader({"Index", "Name", "Type", "Address", "Access", "Size"});
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            table[i][0] = indices[i];
+            table[i][1] = args[i].mName;
+            table[i][2] = args[i].mTypeName;
+            table[i][3] = AddressName(args[i].mAddress);
+            table[i][4] = AccessName(args[i].mAccess);
+            table[i][5] = sizes[i];
+        }
+        *mOut << table << '\n';
+        break;
+    }
+    case 4: {
+        if (!mDriver) {
+            *mOut << "No OpenCL library loaded.\n";
+            return;
         }
+        showMemory();
         break;
     }
     default:
@@ -289,16 +289,20 @@ struct EnqueueKernel
     cl_uint dim = 0;
     std::array<size_t, 3> globalSize{};
     std::array<size_t, 3> localSize{};
+    std::array<size_t, 3> offset{};
 };
 
 void operator<<(_cl_context& C, const EnqueueKernel& E)
 {
     auto lock = C.lock();
-    (*C.mOut) << "run " << E.kernel->name << "((" << CLVector<size_t>(E.globalSize.data(), E.dim);
+    (*C.mOut) << "run " << E.kernel->name << "((" << CLVector<size_t>(E.globalSize.data(), E.dim) << "),";
     if (E.localSize[0] != 0) {
-        (*C.mOut) << "),(" << CLVector<size_t>(E.localSize.data(), E.dim);
+        (*C.mOut) << '(' << CLVector<size_t>(E.localSize.data(), E.dim) << ')';
     }
-    (*C.mOut) << "))\n";
+    if (E.offset != std::array<size_t, 3>{}) {
+        (*C.mOut) << ",(" << CLVector<size_t>(E.offset.data(), E.dim) << ')';
+    }
+    (*C.mOut) << ")\n";
 }
 
 struct CreateBuffer
@@ -649,17 +653,6 @@ clEnqueueNDRangeKernel(cl_command_queue command_queue, cl_kernel kernel,
                        cl_event* event) CL_API_SUFFIX__VERSION_1_0
 {
     cl_context context = command_queue->parent;
-    // CLTestbench does not support offsets on the queue (but it could be added)
-    // so we have to bail out.
-    if (global_work_offset) {
-        for (cl_uint i = 0; i < work_dim; ++i) {
-            if (global_work_offset[i] != 0) {
-                (*context) << Comment("non-zero global work offsets not supported.");
-                return CL_INVALID_VALUE;
-            }
-        }
-    }
-
     const cl_int error = getDriverICD().clEnqueueNDRangeKernel(
         command_queue->object, kernel->object, work_dim, global_work_offset,
         global_work_size, local_work_size, num_events_in_wait_list,
@@ -673,6 +666,8 @@ clEnqueueNDRangeKernel(cl_command_queue command_queue, cl_kernel kernel,
         enqueue.globalSize[i] = global_work_size[i];
         if (local_work_size)
             enqueue.localSize[i] = local_work_size[i];
+        if (global_work_offset)
+            enqueue.offset[i] = global_work_offset[i];
     }
 
     (*context) << enqueue;
@@ -0,0 +1,104 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "driver.hpp"
+#include "error.hpp"
+#include "table.hpp"
+#include "testbench.hpp"
+#include "token.hpp"
+
+using namespace CLTestbench;
+
+namespace
+{
+bool IsDone(const std::shared_future<void>& future)
+{
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+} // namespace
+
+bool Testbench::reportSaveJob(const SaveJob& job)
+{
+    try {
+        job.mDone.get();
+        return true;
+    } catch (const Driver::Error& e) {
+        *mErr << "Save job " << job.mId << " could not read '" << job.mObjectName << "': " << e.what() << '\n';
+    } catch (const std::system_error& e) {
+        *mErr << "Save job " << job.mId << " failed writing to " << job.mFilename << ": " << e.what() << '\n';
+    }
+    return false;
+}
+
+bool Testbench::waitForSaveJobs()
+{
+    bool succeeded = true;
+    for (const SaveJob& job : mSaveJobs) {
+        job.mDone.wait();
+        succeeded &= reportSaveJob(job);
+    }
+    mSaveJobs.clear();
+    return succeeded;
+}
+
+void Testbench::executeJobs(TokenStream&)
+{
+    if (mSaveJobs.empty()) {
+        if (mOptions.verbose) *mOut << "No save jobs.\n";
+        return;
+    }
+
+    // The table refers to these.
+    std::vector<std::string> cells;
+    cells.reserve(mSaveJobs.size() * 2);
+    // Whether each job was listed as finished.
+    std::vector<bool> finished(mSaveJobs.size());
+    Util::Table table(5, mSaveJobs.size());
+    table.setHeader({"Job", "Object", "File", "Bytes", "State"});
+    unsigned row = 0;
+    for (const SaveJob& job : mSaveJobs) {
+        table[row][0] = cells.emplace_back(std::to_string(job.mId));
+        table[row][1] = job.mObjectName;
+        table[row][2] = job.mFilename;
+        table[row][3] = cells.emplace_back(std::to_string(job.mSize));
+        finished[row] = IsDone(job.mDone);
+        if (!finished[row]) {
+            table[row][4] = "writing";
+        } else {
+            try {
+                job.mDone.get();
+                table[row][4] = "done";
+            } catch (...) {
+                table[row][4] = "failed";
+            }
+        }
+        ++row;
+    }
+    *mOut << table << '\n';
+
+    // Finished jobs are reported once.
+    std::vector<SaveJob> writing;
+    for (std::size_t i = 0; i < mSaveJobs.size(); ++i) {
+        if (finished[i]) reportSaveJob(mSaveJobs[i]);
+        else writing.push_back(std::move(mSaveJobs[i]));
+    }
+    mSaveJobs = std::move(writing);
+}
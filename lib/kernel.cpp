@@ -63,5 +63,6 @@ std::shared_ptr<Object> Testbench::evaluateKernel(TokenStream& tokens)
         throw CommandError("Expected ')' for 'kernel' function.", tokens.current());
     tokens.advance();
 
+    waitForBuild(*program);
     return mDriver->createKernel(*program, kernelName.c_str());
 }
@@ -0,0 +1,64 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+
+#include "memoryledger.hpp"
+
+using namespace CLTestbench;
+
+MemoryLedger::Record::~Record()
+{
+    if (mId == 0) return;
+    if (auto ledger = mLedger.lock()) ledger->remove(mId);
+}
+
+MemoryLedger::Record MemoryLedger::add(std::size_t size, cl_mem_flags flags, bool image)
+{
+    std::lock_guard lock(mMutex);
+    const uint64_t id = mNextId++;
+    mAllocations.push_back({id, size, flags, image});
+    mLiveBytes += size;
+    mHighWatermark = std::max(mHighWatermark, mLiveBytes);
+    return Record(weak_from_this(), id);
+}
+
+void MemoryLedger::remove(uint64_t id) noexcept
+{
+    std::lock_guard lock(mMutex);
+    auto match = std::find_if(mAllocations.begin(), mAllocations.end(),
+                              [&](const Allocation& allocation) { return allocation.mId == id; });
+    if (match == mAllocations.end()) return;
+    mLiveBytes -= match->mSize;
+    mAllocations.erase(match);
+}
+
+std::vector<MemoryLedger::Allocation> MemoryLedger::allocations() const
+{
+    std::lock_guard lock(mMutex);
+    return mAllocations;
+}
+
+uint64_t MemoryLedger::liveBytes() const noexcept
+{
+    std::lock_guard lock(mMutex);
+    return mLiveBytes;
+}
+
+uint64_t MemoryLedger::highWatermark() const noexcept
+{
+    std::lock_guard lock(mMutex);
+    return mHighWatermark;
+}
@@ -0,0 +1,82 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <CL/cl.h>
+
+namespace CLTestbench
+{
+/// Device memory held by the memory objects of a driver, and the most ever held at once.
+/// Memory objects keep a Record of their allocation, which leaves the ledger when the
+/// object is released.  Sub-buffers allocate nothing, and have no record.
+class MemoryLedger final : public std::enable_shared_from_this<MemoryLedger>
+{
+public:
+    struct Allocation
+    {
+        /// Identifies the allocation; handles can't be used, as they may be reused once released.
+        uint64_t mId = 0;
+        std::size_t mSize = 0;
+        cl_mem_flags mFlags = 0;
+        bool mImage = false;
+    };
+
+    /// Removes its allocation from the ledger when destroyed.  The ledger may be gone by then.
+    class Record final
+    {
+        std::weak_ptr<MemoryLedger> mLedger;
+        uint64_t mId = 0;
+
+    public:
+        Record() noexcept = default;
+        Record(std::weak_ptr<MemoryLedger> ledger, uint64_t id) noexcept : mLedger(std::move(ledger)), mId(id) {}
+        Record(Record&& other) noexcept : mLedger(std::move(other.mLedger)), mId(other.mId) { other.mId = 0; }
+        Record& operator=(Record&& other) noexcept
+        {
+            std::swap(mLedger, other.mLedger);
+            std::swap(mId, other.mId);
+            return *this;
+        }
+        ~Record();
+
+        /// Zero if nothing is recorded.
+        uint64_t id() const noexcept { return mId; }
+    };
+
+    /// Records an allocation.  The ledger must be owned by a shared_ptr.
+    Record add(std::size_t size, cl_mem_flags flags, bool image);
+
+    /// The live allocations, in the order they were made.
+    std::vector<Allocation> allocations() const;
+    uint64_t liveBytes() const noexcept;
+    uint64_t highWatermark() const noexcept;
+
+private:
+    /// Memory objects may be released by worker threads.
+    mutable std::mutex mMutex;
+    std::vector<Allocation> mAllocations;
+    uint64_t mNextId = 1;
+    uint64_t mLiveBytes = 0;
+    uint64_t mHighWatermark = 0;
+
+    void remove(uint64_t id) noexcept;
+};
+} // namespace CLTestbench
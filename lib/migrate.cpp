@@ -0,0 +1,65 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <optional>
+#include <vector>
+
+#include "driver.hpp"
+#include "error.hpp"
+#include "object.hpp"
+#include "object_cl.hpp"
+#include "testbench.hpp"
+#include "token.hpp"
+
+using namespace CLTestbench;
+
+void Testbench::executeMigrate(TokenStream& tokens)
+{
+    if (!mDriver) throw CommandError("A driver is required for a 'migrate' command.");
+    if (!tokens) throw CommandError("Expected memory objects for 'migrate' command.");
+
+    // The objects are kept until the command is enqueued.
+    std::vector<std::shared_ptr<Object>> objects;
+    std::vector<cl_mem> memObjects;
+    while (tokens && tokens.getTokenText(tokens.current()) != "to") {
+        Token objectToken = tokens.current();
+        auto object = evaluate(tokens);
+        auto* memObj = dynamic_cast<MemoryObject*>(object.get());
+        if (!memObj) throw CommandError("Expected memory object.", objectToken);
+        upload(*memObj);
+        memObjects.push_back(*memObj);
+        objects.push_back(std::move(object));
+        if (tokens.current().mType == Token::Comma) tokens.advance();
+    }
+    if (memObjects.empty()) throw CommandError("Expected memory objects for 'migrate' command.", tokens.current());
+
+    Token toToken = tokens.consume();
+    if (toToken.mType != Token::String || tokens.getTokenText(toToken) != "to")
+        throw CommandError("Expected 'to DEVICE' or 'to host'.", toToken);
+
+    Token targetToken = tokens.consume();
+    std::optional<std::size_t> device;
+    if (targetToken.mType == Token::Constant) {
+        device = tokens.parseConstant<std::size_t>(targetToken);
+        if (*device >= mDriver->getDevices().size())
+            throw CommandError("No such device is selected.  Use 'select devices' to select several.", targetToken);
+    } else if (targetToken.mType != Token::String || tokens.getTokenText(targetToken) != "host") {
+        throw CommandError("Expected device number or 'host'.", targetToken);
+    }
+
+    mDriver->migrate(memObjects, device);
+    if (tokens && mOptions.verbose) *mOut << "Trailing tokens on 'migrate' command ignored.\n";
+}
@@ -15,10 +15,16 @@
 
 #pragma once
 
+#include <future>
+#include <memory>
+#include <string>
 #include <type_traits>
+#include <vector>
 
 #include <CL/cl.h>
 
+#include "bufferpool.hpp"
+#include "memoryledger.hpp"
 #include "object.hpp"
 
 namespace CLTestbench
@@ -44,6 +50,8 @@ public:
         if (std::is_same_v<T, cl_mem>) return "CL memory object";
         if (std::is_same_v<T, cl_kernel>) return "CL kernel object";
         if (std::is_same_v<T, cl_program>) return "CL program object";
+        if (std::is_same_v<T, cl_command_queue>) return "CL command queue";
+        if (std::is_same_v<T, cl_event>) return "CL event";
         return "Unknown CL object";
     }
 
@@ -55,17 +63,121 @@ public:
     }
 };
 
-struct CLImageData
+struct CLMemoryData
 {
     cl_image_format mFormat{};
     cl_image_desc mDescriptor{};
     size_t mBufferSize = 0;
+    cl_mem_flags mFlags = CL_MEM_READ_WRITE;
+    /// The host memory used by a CL_MEM_USE_HOST_PTR object, or read by a non-blocking lazy upload,
+    /// kept alive for as long as the object.
+    std::shared_ptr<const void> mHostData;
+    /// In lazy upload mode, the data to write to the buffer on its first use; see Testbench::upload.
+    std::shared_ptr<const void> mPendingData;
+    /// For sub-buffers, the buffer they were created from and their offset within it.
+    std::shared_ptr<Object> mParent;
+    size_t mParentOffset = 0;
+    /// For buffers from the driver's buffer pool, the reference to the buffer, which goes back to
+    /// the pool when the object is released.
+    BufferPool::Lease mPoolLease;
+    /// The object's entry in the driver's memory ledger.
+    MemoryLedger::Record mLedgerRecord;
+};
+
+struct CLProgramData
+{
+    /// Valid while the program is built asynchronously, or if that build failed.
+    std::shared_future<void> mBuild;
+    /// Key under which to cache the program binary, once the asynchronous build succeeds.
+    std::string mCacheKey;
+};
+
+/// Metadata of a kernel argument, from clGetKernelArgInfo.
+struct KernelArgInfo
+{
+    std::string mName;
+    /// The OpenCL C type, such as "uint" or "float*".
+    std::string mTypeName;
+    cl_kernel_arg_address_qualifier mAddress = CL_KERNEL_ARG_ADDRESS_PRIVATE;
+    cl_kernel_arg_access_qualifier mAccess = CL_KERNEL_ARG_ACCESS_NONE;
+    cl_kernel_arg_type_qualifier mTypeQualifier = 0;
+};
+
+/// The last value bound to a kernel argument, so that identical rebinds can be skipped.
+struct BoundKernelArg
+{
+    enum Kind { None, Value, Memory, Local, SVM } mKind = None;
+    /// The argument value; the cl_mem handle, local memory size or SVM pointer for those kinds.
+    std::vector<unsigned char> mValue;
+    /// The bound memory or SVM object.  It isn't kept alive; once it's released, the binding
+    /// is stale, even if a new object reuses its handle.
+    std::weak_ptr<Object> mObject;
+};
+
+struct CLKernelData
+{
+    /// The kernel function name, kept so that profiled launches needn't query it.
+    std::string mName;
+    /// Argument metadata, queried once when the kernel is created.  This is empty
+    /// when the implementation keeps none, such as without -cl-kernel-arg-info.
+    std::vector<KernelArgInfo> mArgs;
+    /// Arguments bound so far, by index.
+    std::vector<BoundKernelArg> mBound;
+    /// Number of clSetKernelArg calls made, and skipped because the value was already bound.
+    uint64_t mArgSetsIssued = 0;
+    uint64_t mArgSetsSkipped = 0;
+};
+
+struct CLQueueData
+{
+    cl_command_queue_properties mProperties = 0;
 };
 
 struct EmptyStruct {};
 
-using MemoryObject = CLWrapper<cl_mem, CLImageData>;
-using KernelObject = CLWrapper<cl_kernel, EmptyStruct>;
-using ProgramObject = CLWrapper<cl_program, EmptyStruct>;
+/// A shared virtual memory allocation.  SVM pointers don't keep their context alive,
+/// so the allocation retains it until it's freed.
+class SVMObject final : public CLObject
+{
+public:
+    using FreeFnTy = void (*)(cl_context, void*);
+    using ReleaseContextFnTy = cl_int (*)(cl_context);
+
+private:
+    const cl_context mContext;
+    void* const mPointer;
+    const FreeFnTy mFreeFn;
+    const ReleaseContextFnTy mReleaseContextFn;
+
+public:
+    /// The context must already be retained on behalf of this object.
+    SVMObject(cl_context context, void* pointer, std::size_t size, cl_svm_mem_flags flags, FreeFnTy freeFn,
+              ReleaseContextFnTy releaseContextFn) noexcept :
+        mContext(context), mPointer(pointer), mFreeFn(freeFn), mReleaseContextFn(releaseContextFn),
+        mSize(size), mFlags(flags) {}
+    SVMObject(const SVMObject&) = delete;
+    SVMObject& operator=(const SVMObject&) = delete;
+
+    void* pointer() const noexcept { return mPointer; }
+
+    std::string_view type() const noexcept override { return "CL SVM allocation"; }
+
+    const std::size_t mSize;
+    const cl_svm_mem_flags mFlags;
+    /// Fine-grained allocations are accessed by the host without mapping.
+    bool isFineGrained() const noexcept { return mFlags & CL_MEM_SVM_FINE_GRAIN_BUFFER; }
+
+    ~SVMObject()
+    {
+        mFreeFn(mContext, mPointer);
+        mReleaseContextFn(mContext);
+    }
+};
+
+using MemoryObject = CLWrapper<cl_mem, CLMemoryData>;
+using KernelObject = CLWrapper<cl_kernel, CLKernelData>;
+using ProgramObject = CLWrapper<cl_program, CLProgramData>;
+using QueueObject = CLWrapper<cl_command_queue, CLQueueData>;
+using EventObject = CLWrapper<cl_event, EmptyStruct>;
 
 } // namespace CLTestbench
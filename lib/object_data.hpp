@@ -16,11 +16,16 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
+#include <string_view>
 
 #include "object.hpp"
 
 namespace CLTestbench
 {
+class TokenStream;
+struct Token;
+
 class DataObject : public Object
 {
 public:
@@ -28,4 +33,10 @@ public:
     virtual const void* data() const noexcept = 0;
     virtual ~DataObject() = default;
 };
+
+/// Parses a constant as a value of the named OpenCL C scalar type, such as "uint" or
+/// "unsigned int".  Returns null if the type isn't a scalar type.
+std::shared_ptr<DataObject> ParseScalar(const TokenStream&, Token, std::string_view typeName);
+/// The size of the named OpenCL C scalar type, or zero if it isn't one.
+std::size_t ScalarTypeSize(std::string_view typeName);
 } // namespace CLTestbench
@@ -15,8 +15,11 @@
 
 #include <iostream>
 
+#include "bufferpool.hpp"
 #include "driver.hpp"
 #include "constant.hpp"
+#include "istringview.hpp"
+#include "programcache.hpp"
 #include "testbench.hpp"
 #include "token.hpp"
 
@@ -35,9 +38,29 @@ void Testbench::executeSet(TokenStream& tokens)
         *mOut << "Options:"
                  "\n  verbose:  " << YesNo(mOptions.verbose) <<
                  "\n  caret:    " << YesNo(mOptions.caretPrint) <<
-                 "\n  echo:     " << YesNo(mOptions.scriptEcho) << '\n';
-        if (mDriver)
+                 "\n  echo:     " << YesNo(mOptions.scriptEcho) <<
+                 "\n  programcache: " << YesNo(mOptions.programCache);
+        if (mProgramCache)
+            *mOut << " (" << mProgramCache->mHits << " hits, " << mProgramCache->mMisses << " misses)";
+        *mOut << "\n  asyncbuild: " << YesNo(mOptions.asyncBuild) <<
+                 "\n  lazyupload: " << YesNo(mOptions.lazyUpload) <<
+                 "\n  asyncsave: " << YesNo(mOptions.asyncSave) << '\n';
+        if (mDriver) {
             *mOut << "Driver blocking commands: " << YesNo(mDriver->mBlock) << '\n';
+            *mOut << "Driver profiling: " << YesNo(mDriver->isProfiling()) << '\n';
+            *mOut << "Driver transfers: " << (mDriver->mTransfer == Driver::Transfer::Map ? "map" : "copy") << '\n';
+            *mOut << "Driver stream chunk: ";
+            if (mDriver->mStreamChunk) *mOut << mDriver->mStreamChunk << " bytes\n";
+            else *mOut << "no\n";
+            const BufferPool* pool = mDriver->getBufferPool();
+            *mOut << "Driver buffer pool: ";
+            if (pool && pool->isEnabled()) {
+                const auto stats = pool->getStats();
+                *mOut << pool->getLimit() << " bytes (" << stats.mHits << " hits, " << stats.mMisses << " misses)\n";
+            } else {
+                *mOut << "no\n";
+            }
+        }
         return;
     }
 
@@ -45,7 +68,10 @@ void Testbench::executeSet(TokenStream& tokens)
     if (!optionToken) throw CommandError("Unknown option.", optionToken);
 
     IStringView optionStr = tokens.getTokenText(optionToken);
-    const std::initializer_list<std::string_view> options{"verbose", "caret", "echo", "block"};
+    const std::initializer_list<std::string_view> options{"verbose", "caret", "echo", "block", "profile",
+                                                                 "programcache", "asyncbuild", "transfer",
+                                                                 "bufferpool", "lazyupload", "streamchunk",
+                                                                 "asyncsave"};
 
     Token valueToken = tokens.consume();
     if (!valueToken) throw CommandError("Missing argument for 'set' command.", optionToken);
@@ -57,6 +83,53 @@ void Testbench::executeSet(TokenStream& tokens)
     case 3:
         if (!mDriver) throw CommandError("No driver loaded.", optionToken);
         mDriver->mBlock = tokens.parseConstant<bool>(valueToken); break;
+    case 4:
+        if (!mDriver) throw CommandError("No driver loaded.", optionToken);
+        mDriver->setProfiling(tokens.parseConstant<bool>(valueToken)); break;
+    case 5:
+        if (IStringView(tokens.getTokenText(valueToken)) == "clear") {
+            const unsigned count = getProgramCache().clear();
+            if (mOptions.verbose) *mOut << "Removed " << count << " cached program binaries.\n";
+            break;
+        }
+        mOptions.programCache = tokens.parseConstant<bool>(valueToken); break;
+    case 6: mOptions.asyncBuild = tokens.parseConstant<bool>(valueToken); break;
+    case 7: {
+        if (!mDriver) throw CommandError("No driver loaded.", optionToken);
+        const std::size_t mode = IStringView(tokens.getTokenText(valueToken)).autocomplete({"copy", "map"});
+        if (mode == 0) {
+            mDriver->mTransfer = Driver::Transfer::Copy;
+        } else if (mode == 1) {
+            mDriver->mTransfer = Driver::Transfer::Map;
+            if (!mDriver->hasUnifiedMemory() && mOptions.verbose)
+                *mOut << "The device does not report unified memory, so transfers will still copy.\n";
+        } else {
+            throw CommandError("Expected 'map' or 'copy'.", valueToken);
+        }
+        break;
+    }
+    case 8: {
+        if (!mDriver) throw CommandError("No driver loaded.", optionToken);
+        // A constant sets the limit of idle bytes, which 'on' leaves at its default.
+        constexpr std::size_t DefaultPoolLimit = 256 * 1024 * 1024;
+        std::size_t limit = 0;
+        if (valueToken.mType == Token::Constant) {
+            limit = tokens.parseConstant<std::size_t>(valueToken);
+        } else if (tokens.parseConstant<bool>(valueToken)) {
+            const BufferPool* pool = mDriver->getBufferPool();
+            limit = pool && pool->isEnabled() ? pool->getLimit() : DefaultPoolLimit;
+        }
+        mDriver->setBufferPoolLimit(limit);
+        break;
+    }
+    case 9: mOptions.lazyUpload = tokens.parseConstant<bool>(valueToken); break;
+    case 10:
+        if (!mDriver) throw CommandError("No driver loaded.", optionToken);
+        if (valueToken.mType == Token::Constant) mDriver->mStreamChunk = tokens.parseConstant<std::size_t>(valueToken);
+        else if (!tokens.parseConstant<bool>(valueToken)) mDriver->mStreamChunk = 0;
+        else throw CommandError("Expected a chunk size in bytes, or 'off'.", valueToken);
+        break;
+    case 11: mOptions.asyncSave = tokens.parseConstant<bool>(valueToken); break;
     default: throw CommandError("Unknown option.", optionToken);
     }
 }
@@ -14,19 +14,31 @@
 // along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <algorithm>
+#include <optional>
 #include <iostream>
 #include <memory>
 
+#include "cache.hpp"
 #include "driver.hpp"
 #include "error.hpp"
 #include "object.hpp"
 #include "object_cl.hpp"
 #include "object_data.hpp"
+#include "programcache.hpp"
 #include "testbench.hpp"
 #include "token.hpp"
 
 using namespace CLTestbench;
 
+ProgramCache& Testbench::getProgramCache()
+{
+    if (!mProgramCache) {
+        std::filesystem::path directory = CacheDirectory();
+        mProgramCache = std::make_unique<ProgramCache>(directory.empty() ? directory : directory / "programs");
+    }
+    return *mProgramCache;
+}
+
 std::shared_ptr<Object> Testbench::evaluateProgram(TokenStream& tokens)
 {
     // Expect a '('.
@@ -68,8 +80,42 @@ std::shared_ptr<Object> Testbench::evaluateProgram(TokenStream& tokens)
         throw CommandError("Expected ')' for 'program' function.", paren);
     tokens.advance();
 
+    std::string cacheKey;
+    // Cached binaries are for one device, so programs of several devices are always built from source.
+    if (mOptions.programCache && mDriver->getDevices().size() == 1) {
+        const Driver::PlatformInfo platform = mDriver->getPlatformInfo(mDriver->mPlatform);
+        const Driver::DeviceInfo& device = mDriver->getSelectedDeviceInfo();
+        // The queried strings may carry their null terminators.
+        cacheKey = ProgramCache::MakeKey(programSource, buildOpts, platform.mName.c_str(), device.mName.c_str(),
+                                         device.mDriverVersion.c_str());
+
+        ProgramCache& cache = getProgramCache();
+        if (std::optional<std::vector<char>> binary = cache.load(cacheKey)) {
+            try {
+                auto program = mDriver->createProgramBinary(binary->data(), binary->size());
+                mDriver->buildProgram(*program, buildOpts.c_str());
+                ++cache.mHits;
+                if (mOptions.verbose) *mOut << "Loaded program binary from cache.\n";
+                return program;
+            } catch (const Driver::Error&) {
+                // The driver may reject binaries it produced itself, such as after an update
+                // which kept its version string.  Fall back to building from source.
+                cache.discard(cacheKey);
+            }
+        }
+        // A miss, whether or not the built binary can be stored.
+        ++cache.mMisses;
+    }
+
     auto program = mDriver->createProgram(programSource);
 
+    if (mOptions.asyncBuild) {
+        // The first use of the program waits for the build; see waitForBuild.
+        program->data.mBuild = mDriver->buildProgramAsync(*program, std::move(buildOpts));
+        program->data.mCacheKey = std::move(cacheKey);
+        return program;
+    }
+
     // Intercept build failures here
     try {
         mDriver->buildProgram(*program, buildOpts.c_str());
@@ -82,9 +128,39 @@ std::shared_ptr<Object> Testbench::evaluateProgram(TokenStream& tokens)
         throw;
     }
 
+    if (!cacheKey.empty()) {
+        ProgramCache& cache = getProgramCache();
+        if (!cache.store(cacheKey, mDriver->programBinary(*program)) && mOptions.verbose)
+            *mOut << "Program binary was not cached.\n";
+    }
+
     return program;
 }
 
+void Testbench::waitForBuild(Object& object)
+{
+    auto& program = static_cast<ProgramObject&>(object);
+    if (!program.data.mBuild.valid()) return;
+
+    try {
+        program.data.mBuild.get();
+    } catch (const Driver::Error& e) {
+        // The future is kept, so that every use of a failed program fails.
+        if (e.mError == CL_BUILD_PROGRAM_FAILURE) {
+            *mErr << "Program build failure:\n" << mDriver->programBuildLog(program) << '\n';
+        }
+        throw;
+    }
+    program.data.mBuild = {};
+
+    if (!program.data.mCacheKey.empty()) {
+        ProgramCache& cache = getProgramCache();
+        if (!cache.store(program.data.mCacheKey, mDriver->programBinary(program)) && mOptions.verbose)
+            *mOut << "Program binary was not cached.\n";
+        program.data.mCacheKey.clear();
+    }
+}
+
 std::shared_ptr<Object> Testbench::evaluateBinary(TokenStream& tokens)
 {
     // Expect a '('.
@@ -0,0 +1,140 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+#include <unistd.h>
+
+#include "programcache.hpp"
+
+using namespace CLTestbench;
+
+namespace
+{
+constexpr std::string_view Extension = ".bin";
+
+/// 64-bit FNV-1a.
+class Hash final
+{
+    std::uint64_t mValue = 0xcbf29ce484222325;
+
+public:
+    void add(std::string_view data)
+    {
+        for (unsigned char c : data) {
+            mValue ^= c;
+            mValue *= 0x100000001b3;
+        }
+    }
+
+    std::string hex() const
+    {
+        constexpr char digits[] = "0123456789abcdef";
+        std::string text(16, '0');
+        for (unsigned i = 0; i < 16; ++i) text[15 - i] = digits[(mValue >> (i * 4)) & 0xf];
+        return text;
+    }
+};
+} // namespace
+
+std::string ProgramCache::MakeKey(std::string_view source, std::string_view options, std::string_view platform,
+                                  std::string_view device, std::string_view driverVersion)
+{
+    // Each field is prefixed with its length, so that moving text from one to the next changes the key.
+    std::string key;
+    for (std::string_view field : {source, options, platform, device, driverVersion}) {
+        key += std::to_string(field.size());
+        key += ':';
+        key += field;
+    }
+    return key;
+}
+
+std::filesystem::path ProgramCache::getFile(const std::string& key) const
+{
+    Hash hash;
+    hash.add(key);
+    std::filesystem::path file = mDirectory / hash.hex();
+    file += Extension;
+    return file;
+}
+
+std::optional<std::vector<char>> ProgramCache::load(const std::string& key) const
+{
+    if (mDirectory.empty()) return std::nullopt;
+    std::ifstream in(getFile(key), std::ios::binary);
+    if (!in) return std::nullopt;
+    // The file starts with the key it was stored for, which must match, since file names are only hashes.
+    std::uint64_t keySize = 0;
+    if (!in.read(reinterpret_cast<char*>(&keySize), sizeof(keySize)) || keySize != key.size()) return std::nullopt;
+    std::string storedKey(key.size(), '\0');
+    if (!in.read(storedKey.data(), static_cast<std::streamsize>(storedKey.size())) || storedKey != key)
+        return std::nullopt;
+    std::vector<char> binary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (in.bad() || binary.empty()) return std::nullopt;
+    return binary;
+}
+
+bool ProgramCache::store(const std::string& key, const std::vector<char>& binary) const
+{
+    if (mDirectory.empty() || binary.empty()) return false;
+
+    std::error_code error;
+    std::filesystem::create_directories(mDirectory, error);
+    // Write aside and rename, so that concurrent sessions never load a partial binary.
+    const std::filesystem::path file = getFile(key);
+    // Each process writes its own temporary file, so that they don't truncate each other's.
+    std::filesystem::path temporary = file;
+    temporary += "." + std::to_string(getpid()) + ".tmp";
+    bool written = false;
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        const std::uint64_t keySize = key.size();
+        out.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+        out.write(key.data(), static_cast<std::streamsize>(key.size()));
+        out.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+        written = static_cast<bool>(out.flush());
+    }
+    if (written) {
+        std::filesystem::rename(temporary, file, error);
+        written = !error;
+    }
+    if (!written) std::filesystem::remove(temporary, error);
+    return written;
+}
+
+void ProgramCache::discard(const std::string& key) const
+{
+    if (mDirectory.empty()) return;
+    std::error_code error;
+    std::filesystem::remove(getFile(key), error);
+}
+
+unsigned ProgramCache::clear() const
+{
+    if (mDirectory.empty()) return 0;
+    unsigned count = 0;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(mDirectory, error)) {
+        if (entry.path().extension() != Extension) continue;
+        std::error_code removeError;
+        if (std::filesystem::remove(entry.path(), removeError)) ++count;
+    }
+    return count;
+}
@@ -0,0 +1,57 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CLTestbench
+{
+/// Persistent store of program binaries, so that programs built from
+/// source don't need to be recompiled on every session.
+class ProgramCache final
+{
+public:
+    /// Binaries are stored as files in this directory.  An empty path disables storing binaries.
+    explicit ProgramCache(std::filesystem::path directory) : mDirectory(std::move(directory)) {}
+
+    /// Identifies a build.  A change in any of these produces a different key.  Headers included
+    /// by the source aren't part of the key, so editing them doesn't invalidate the binary.
+    static std::string MakeKey(std::string_view source, std::string_view options, std::string_view platform,
+                               std::string_view device, std::string_view driverVersion);
+
+    /// Returns the binary stored for this key, if any.
+    std::optional<std::vector<char>> load(const std::string& key) const;
+    /// Returns false if the binary could not be written.
+    bool store(const std::string& key, const std::vector<char>& binary) const;
+    /// Removes the binary stored for this key, such as when the driver rejects it.
+    void discard(const std::string& key) const;
+    /// Removes all stored binaries.  Returns the number of binaries removed.
+    unsigned clear() const;
+
+    /// Programs loaded from the cache, and programs which had to be built from source, whether or not
+    /// their binary could then be stored.
+    unsigned mHits = 0;
+    unsigned mMisses = 0;
+
+private:
+    std::filesystem::path getFile(const std::string& key) const;
+
+    std::filesystem::path mDirectory;
+};
+} // namespace CLTestbench
@@ -0,0 +1,53 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <memory>
+
+#include "driver.hpp"
+#include "error.hpp"
+#include "istringview.hpp"
+#include "object.hpp"
+#include "object_cl.hpp"
+#include "testbench.hpp"
+#include "token.hpp"
+
+using namespace CLTestbench;
+
+namespace
+{
+const std::initializer_list<std::string_view> QueuePropertyNames{"out_of_order", "profiling"};
+}
+
+std::shared_ptr<Object> Testbench::evaluateQueue(TokenStream& tokens)
+{
+    if (!tokens.expect(Token::OpenParen)) throw CommandError("Expected '(' for 'queue' function.", tokens.current());
+
+    cl_command_queue_properties properties = 0;
+    while (tokens && tokens.current().mType != Token::CloseParen) {
+        Token propertyToken = tokens.consume();
+        if (propertyToken.mType != Token::String) throw CommandError("Expected queue property.", propertyToken);
+        switch (IStringView(tokens.getTokenText(propertyToken)).autocomplete(QueuePropertyNames)) {
+        case 0: properties |= CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE; break;
+        case 1: properties |= CL_QUEUE_PROFILING_ENABLE; break;
+        case IStringView::ambiguous: throw CommandError("Ambiguous queue property.", propertyToken);
+        default: throw CommandError("Unknown queue property.", propertyToken);
+        }
+        if (tokens.current().mType == Token::Comma) tokens.advance();
+    }
+
+    if (!tokens.expect(Token::CloseParen)) throw CommandError("Expected ')' for 'queue' function.", tokens.current());
+
+    return mDriver->createQueue(properties);
+}
@@ -13,15 +13,18 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include <array>
 #include <iostream>
 #include <optional>
+#include <vector>
 
 #include "constant.hpp"
 #include "driver.hpp"
 #include "error.hpp"
 #include "object_cl.hpp"
 #include "object_data.hpp"
+#include "split.hpp"
 #include "testbench.hpp"
 #include "token.hpp"
 
@@ -65,14 +68,12 @@ std::array<std::size_t, 3> ParseDim(TokenStream& tokens)
 }
 }
 
-void Testbench::executeRun(TokenStream& tokens)
+Testbench::Launch Testbench::parseLaunch(TokenStream& tokens)
 {
-    if (!mDriver)
-        throw CommandError("An OpenCL implementation must be loaded for a 'run' command.");
-
+    Launch launch;
     auto kernelToken = tokens.current();
-    auto kernel = evaluate(tokens);
-    auto* kernelObj = dynamic_cast<KernelObject*>(kernel.get());
+    launch.mKernel = evaluate(tokens);
+    auto* kernelObj = dynamic_cast<KernelObject*>(launch.mKernel.get());
     if (!kernelObj)
         throw CommandError("Expected kernel object.", kernelToken);
 
@@ -84,45 +85,34 @@ void Testbench::executeRun(TokenStream& tokens)
     if (token.mType != Token::OpenParen)
         throw CommandError("Expected '('.", token);
 
-    std::optional<std::array<std::size_t, 3>> localSize;
-    auto globalSize = ParseDim(tokens);
+    launch.mGlobal = ParseDim(tokens);
 
     if (!tokens.expect(Token::Comma))
         throw CommandError("Expected ','.", token);
 
     if (tokens.expect(Token::OpenParen))
-        localSize = ParseDim(tokens);
+        launch.mLocal = ParseDim(tokens);
 
-    // Any subsequent tokens enumerate kernel arguments.
     token = tokens.consume();
     if (token.mType != Token::Comma && token.mType != Token::CloseParen)
         throw CommandError("Expected ',' or ')'.", token);
 
+    // A third size is the global work offset.  A constant in parenthesis isn't a valid
+    // kernel argument, so this can't be confused with one.
+    if (token.mType == Token::Comma && tokens.current().mType == Token::OpenParen &&
+        tokens.next().mType == Token::Constant) {
+        tokens.advance();
+        launch.mOffset = ParseDim(tokens);
+        token = tokens.consume();
+        if (token.mType != Token::Comma && token.mType != Token::CloseParen)
+            throw CommandError("Expected ',' or ')'.", token);
+    }
+
+    // Any subsequent tokens enumerate kernel arguments.
     uint32_t argIndex = 0;
     if (token.mType != Token::CloseParen) {
         do {
-            if (token.mType == Token::Constant) {
-                // This is a tricky one because it could be any type.
-                // The only way of knowing is to query the argument type of the
-                // kernel, which isn't implemented at the moment.
-                // The type is required to set the appropriate "size" argument
-                // to clSetKernelArg.
-                throw CommandError([&](std::ostream& out){
-                    out << "A type is required for a constant argument.  Example:\n"
-                           "  ulong(" << tokens.getTokenText(token) << ')';
-                }, token);
-            }
-            // Anything else we evaluate to a memory object.
-            Token objectTokenStart = tokens.current();
-            auto evaluated = evaluate(tokens);
-            if (auto* memObj = dynamic_cast<MemoryObject*>(evaluated.get())) {
-                if (!memObj) throw CommandError("Expected memory object.", objectTokenStart);
-                mDriver->setKernelArg(*kernelObj, argIndex, *memObj);
-            } else if (auto* dataObj = dynamic_cast<DataObject*>(evaluated.get())) {
-                mDriver->setKernelArg(*kernelObj, argIndex, dataObj->data(), dataObj->size());
-            } else {
-                throw CommandError("Unsupported kernel argument type.", token);
-            }
+            bindArgument(*kernelObj, argIndex, tokens);
             token = tokens.consume();
             argIndex++;
 
@@ -131,5 +121,180 @@ void Testbench::executeRun(TokenStream& tokens)
         } while(token.mType != Token::CloseParen);
     }
 
-    mDriver->enqueueKernel(*kernelObj, globalSize, localSize);
+    return launch;
+}
+
+void Testbench::parseLaunchOrder(TokenStream& tokens, Launch& launch)
+{
+    auto isClause = [&](Token token) {
+        std::string_view text = tokens.getTokenText(token);
+        return token.mType == Token::String && (text == "on" || text == "after" || text == "split");
+    };
+
+    while (tokens) {
+        Token clause = tokens.consume();
+        std::string_view clauseText = tokens.getTokenText(clause);
+        if (clause.mType == Token::String && clauseText == "split") {
+            if (launch.mSplit) throw CommandError("The launch is already split.", clause);
+            launch.mSplit = true;
+            while (tokens && !isClause(tokens.current())) {
+                Token weightToken = tokens.consume();
+                if (weightToken.mType != Token::Constant) throw CommandError("Expected weight constant.", weightToken);
+                launch.mWeights.push_back(tokens.parseConstant<uint32_t>(weightToken));
+                if (tokens.current().mType == Token::Comma) tokens.advance();
+            }
+            const std::size_t devices = mDriver->getDevices().size();
+            if (launch.mWeights.empty()) launch.mWeights.assign(devices, 1);
+            if (launch.mWeights.size() != devices) {
+                throw CommandError([=](std::ostream& out) {
+                    out << "Expected a weight for each of the " << devices << " selected devices.";
+                }, clause);
+            }
+        } else if (clause.mType == Token::String && clauseText == "on") {
+            if (launch.mQueue) throw CommandError("A queue was already given.", clause);
+            Token queueToken = tokens.current();
+            launch.mQueue = evaluate(tokens);
+            if (!dynamic_cast<QueueObject*>(launch.mQueue.get()))
+                throw CommandError("Expected queue object.", queueToken);
+        } else if (clause.mType == Token::String && clauseText == "after") {
+            if (!tokens) throw CommandError("Expected event objects.", tokens.current());
+            // Events up to the next clause, optionally separated by commas.
+            while (tokens && !isClause(tokens.current())) {
+                Token eventToken = tokens.current();
+                auto event = evaluate(tokens);
+                if (!dynamic_cast<EventObject*>(event.get())) throw CommandError("Expected event object.", eventToken);
+                launch.mWaitFor.push_back(std::move(event));
+                if (tokens.current().mType == Token::Comma) tokens.advance();
+            }
+        } else {
+            throw CommandError("Expected 'on QUEUE', 'after EVENTS' or 'split'.", clause);
+        }
+    }
+    if (launch.mSplit && launch.mQueue)
+        throw CommandError("A split launch runs on the queues of the selected devices, not on a given queue.");
+}
+
+std::shared_ptr<Object> Testbench::enqueueLaunch(Launch& launch, bool wantEvent)
+{
+    auto& kernel = static_cast<KernelObject&>(*launch.mKernel);
+    if (!launch.mLocal) launch.mLocal = findTunedLocalSize(launch);
+
+    // The kernel would use the handle of a freed object.
+    const auto& bound = kernel.data.mBound;
+    for (std::size_t arg = 0; arg < bound.size(); ++arg) {
+        const bool isObject = bound[arg].mKind == BoundKernelArg::Memory || bound[arg].mKind == BoundKernelArg::SVM;
+        if (isObject && bound[arg].mObject.expired()) {
+            throw CommandError([=](std::ostream& out) {
+                out << "Argument " << arg << " of the kernel was released; bind another object to it.";
+            });
+        }
+    }
+
+    auto* queue = static_cast<QueueObject*>(launch.mQueue.get());
+    std::vector<cl_event> waitList;
+    for (auto& event : launch.mWaitFor) waitList.push_back(static_cast<EventObject&>(*event));
+
+    if (launch.mSplit) {
+        if (wantEvent) throw CommandError("A split launch has no single event to assign.");
+        // The first dimension is split, so that each device runs whole work-groups.
+        const std::size_t granularity = launch.mLocal ? (*launch.mLocal)[0] : 1;
+        const auto parts = SplitRange(launch.mGlobal[0], launch.mWeights, granularity);
+        for (std::size_t device = 0; device < parts.size(); ++device) {
+            if (parts[device].mSize == 0) continue;
+            Driver::EnqueueSize offset = launch.mOffset.value_or(Driver::EnqueueSize{});
+            offset[0] += parts[device].mOffset;
+            Driver::EnqueueSize global = launch.mGlobal;
+            global[0] = parts[device].mSize;
+            mDriver->enqueueKernelOnDevice(device, kernel, offset, global, launch.mLocal, waitList);
+        }
+        return nullptr;
+    }
+
+    cl_event event = nullptr;
+    mDriver->enqueueKernel(kernel, launch.mGlobal, launch.mLocal, launch.mOffset, wantEvent ? &event : nullptr, queue,
+                           waitList);
+    if (!wantEvent) return nullptr;
+    return mDriver->wrapEvent(event);
+}
+
+void Testbench::executeRun(TokenStream& tokens)
+{
+    if (!mDriver)
+        throw CommandError("An OpenCL implementation must be loaded for a 'run' command.");
+
+    Launch launch = parseLaunch(tokens);
+    parseLaunchOrder(tokens, launch);
+    enqueueLaunch(launch, false);
+    rememberLaunch(std::move(launch));
+}
+
+std::shared_ptr<Object> Testbench::evaluateRun(TokenStream& tokens)
+{
+    Launch launch = parseLaunch(tokens);
+    parseLaunchOrder(tokens, launch);
+    auto event = enqueueLaunch(launch, true);
+    rememberLaunch(std::move(launch));
+    return event;
+}
+
+void Testbench::rememberLaunch(Launch&& launch)
+{
+    // Launches of released kernels can't be repeated, so they're forgotten here too.
+    mLastLaunches.erase(std::remove_if(mLastLaunches.begin(), mLastLaunches.end(),
+                                       [&](const LastLaunch& last) {
+                                           auto kernel = last.mKernel.lock();
+                                           return !kernel || kernel == launch.mKernel;
+                                       }),
+                        mLastLaunches.end());
+
+    LastLaunch last;
+    last.mKernel = launch.mKernel;
+    if (launch.mQueue) last.mQueue = launch.mQueue;
+    last.mWaitFor.assign(launch.mWaitFor.begin(), launch.mWaitFor.end());
+    launch.mKernel.reset();
+    launch.mQueue.reset();
+    launch.mWaitFor.clear();
+    last.mLaunch = std::move(launch);
+    mLastLaunches.push_back(std::move(last));
+}
+
+void Testbench::executeRerun(TokenStream& tokens)
+{
+    if (!mDriver)
+        throw CommandError("An OpenCL implementation must be loaded for a 'rerun' command.");
+
+    // The last launch of any kernel, unless one is given.
+    auto last = mLastLaunches.rbegin();
+    if (tokens && tokens.current().mType != Token::Constant) {
+        Token kernelToken = tokens.current();
+        auto kernel = evaluate(tokens);
+        if (!dynamic_cast<KernelObject*>(kernel.get())) throw CommandError("Expected kernel object.", kernelToken);
+        last = std::find_if(mLastLaunches.rbegin(), mLastLaunches.rend(),
+                            [&](const LastLaunch& launch) { return launch.mKernel.lock() == kernel; });
+        if (last == mLastLaunches.rend()) throw CommandError("The kernel has not been run.", kernelToken);
+    }
+    if (last == mLastLaunches.rend()) throw CommandError("No kernel has been run.");
+
+    uint32_t count = 1;
+    if (tokens) {
+        Token countToken = tokens.consume();
+        if (countToken.mType != Token::Constant) throw CommandError("Expected run count.", countToken);
+        count = tokens.parseConstant<uint32_t>(countToken);
+    }
+    if (tokens && mOptions.verbose) *mOut << "Trailing tokens on 'rerun' command ignored.\n";
+
+    Launch launch = last->mLaunch;
+    launch.mKernel = last->mKernel.lock();
+    if (!launch.mKernel) throw CommandError("The kernel of the last launch was released.");
+    if (last->mQueue) {
+        launch.mQueue = last->mQueue->lock();
+        if (!launch.mQueue) throw CommandError("The queue of the launch was released.");
+    }
+    for (const auto& waitFor : last->mWaitFor) {
+        launch.mWaitFor.push_back(waitFor.lock());
+        if (!launch.mWaitFor.back()) throw CommandError("An event which the launch waits for was released.");
+    }
+
+    // Only the sizes, queue, events and split are replayed; the kernel keeps its current arguments.
+    for (uint32_t i = 0; i < count; ++i) enqueueLaunch(launch, false);
 }
@@ -13,10 +13,22 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <thread>
 #include <vector>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "cltb_config.h"
 #include "driver.hpp"
 #include "error.hpp"
@@ -34,17 +46,160 @@ namespace
 class ImageDataWrapper final : public ImageObject
 {
 public:
-    CLImageData mImageData;
+    const CLMemoryData* mImageData;
     const void* mData;
 
-    cl_image_format format() const noexcept override { return mImageData.mFormat; }
-    cl_image_desc descriptor() const noexcept override { return mImageData.mDescriptor; }
-    std::size_t size() const noexcept override { return mImageData.mBufferSize; }
+    cl_image_format format() const noexcept override { return mImageData->mFormat; }
+    cl_image_desc descriptor() const noexcept override { return mImageData->mDescriptor; }
+    std::size_t size() const noexcept override { return mImageData->mBufferSize; }
     const void* data() const noexcept override { return mData; }
 
     // This is a short-lived object, so this will never be called.
     std::string_view type() const noexcept override { return ""; }
 };
+
+/// Unmaps a buffer mapped by 'save' once the data is written.
+struct BufferMapping final
+{
+    Driver& mDriver;
+    cl_mem mBuffer;
+    void* mMapped = nullptr;
+
+    ~BufferMapping()
+    {
+        if (!mMapped) return;
+        try {
+            mDriver.unmapBuffer(mBuffer, mMapped);
+        } catch (const Driver::Error&) {
+            // Nothing to be done; the buffer stays mapped.
+        }
+    }
+};
+
+/// A file written with pwrite, which is closed with the object.
+class OutputFile final
+{
+    int mFD;
+
+public:
+    /// Creates or truncates the file.  Throws std::system_error if it can't be opened.
+    explicit OutputFile(const std::filesystem::path& path) :
+        mFD(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666))
+    {
+        if (mFD < 0) throw std::system_error(errno, std::generic_category());
+    }
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    ~OutputFile() { close(mFD); }
+
+    /// Writes the data at the offset.  Throws std::system_error if not all of it could be written.
+    void write(const void* data, std::size_t offset, std::size_t size) const
+    {
+        const char* bytes = static_cast<const char*>(data);
+        std::size_t written = 0;
+        while (written < size) {
+            const ssize_t result = pwrite(mFD, bytes + written, size - written, static_cast<off_t>(offset + written));
+            if (result < 0 && errno == EINTR) continue;
+            if (result <= 0) throw std::system_error(errno, std::generic_category());
+            written += static_cast<std::size_t>(result);
+        }
+    }
+};
+
+/// Writes chunks of a file with pwrite on a worker thread, in the order they are queued, so that
+/// chunks can be read from the device while earlier ones reach the disk.
+class ChunkWriter final
+{
+    struct Chunk
+    {
+        const void* mData;
+        std::size_t mOffset;
+        std::size_t mSize;
+        std::promise<void> mWritten;
+    };
+
+    const OutputFile mFile;
+    std::mutex mMutex;
+    std::condition_variable mQueued;
+    std::deque<Chunk> mChunks;
+    bool mClosing = false;
+    /// Started last, once the other members are ready.
+    std::thread mThread;
+
+    void run()
+    {
+        for (;;) {
+            std::unique_lock lock(mMutex);
+            mQueued.wait(lock, [this] { return mClosing || !mChunks.empty(); });
+            if (mChunks.empty()) return;
+            Chunk chunk = std::move(mChunks.front());
+            mChunks.pop_front();
+            lock.unlock();
+
+            try {
+                mFile.write(chunk.mData, chunk.mOffset, chunk.mSize);
+                chunk.mWritten.set_value();
+            } catch (const std::system_error&) {
+                chunk.mWritten.set_exception(std::current_exception());
+            }
+        }
+    }
+
+public:
+    /// Creates or truncates the file.
+    explicit ChunkWriter(const std::filesystem::path& path) : mFile(path), mThread([this] { run(); }) {}
+    ChunkWriter(const ChunkWriter&) = delete;
+    ChunkWriter& operator=(const ChunkWriter&) = delete;
+
+    /// Writes the queued chunks before closing the file.
+    ~ChunkWriter()
+    {
+        {
+            std::lock_guard lock(mMutex);
+            mClosing = true;
+        }
+        mQueued.notify_one();
+        mThread.join();
+    }
+
+    /// Queues a chunk, which must stay readable until the returned future is ready.
+    std::future<void> write(const void* data, std::size_t offset, std::size_t size)
+    {
+        Chunk chunk{data, offset, size, {}};
+        std::future<void> written = chunk.mWritten.get_future();
+        {
+            std::lock_guard lock(mMutex);
+            mChunks.push_back(std::move(chunk));
+        }
+        mQueued.notify_one();
+        return written;
+    }
+};
+
+/// Removes the file left by a 'save' which failed, so that it can't pass for a whole one.  Devices and
+/// pipes are left alone.
+void RemovePartialFile(const std::filesystem::path& path) noexcept
+{
+    std::error_code ignored;
+    if (std::filesystem::is_regular_file(path, ignored)) std::filesystem::remove(path, ignored);
+}
+
+/// Unmaps a coarse-grained SVM allocation mapped by 'save' once the data is written.
+struct SVMMapping final
+{
+    Driver& mDriver;
+    void* mPointer;
+
+    ~SVMMapping()
+    {
+        try {
+            mDriver.unmapSVM(mPointer);
+        } catch (const Driver::Error&) {
+            // Nothing to be done; the allocation stays mapped.
+        }
+    }
+};
 }
 
 void Testbench::executeSave(TokenStream& tokens)
@@ -58,14 +213,21 @@ void Testbench::executeSave(TokenStream& tokens)
     assert(object && "nullptr objects not expected");
 
     std::vector<char> memObjData;
+    std::optional<BufferMapping> mapping;
+    std::optional<SVMMapping> svmMapping;
     const char* dataPtr = nullptr;
     std::size_t dataSize = 0;
 
     auto filename = TrimWhitespace(tokens.currentText());
     std::filesystem::path filepath(filename);
+    // Only device buffers are saved in the background.
+    auto noteSynchronous = [&] {
+        if (mOptions.asyncSave && mOptions.verbose) *mOut << "This object is saved at once, not in the background.\n";
+    };
 
     // Find out what we're saving.
     if (auto* data = dynamic_cast<DataObject*>(object.get())) {
+        noteSynchronous();
         dataPtr = static_cast<const char*>(data->data());
         dataSize = data->size();
 #if CLTB_USE_LIBPNG
@@ -81,8 +243,12 @@ void Testbench::executeSave(TokenStream& tokens)
     } else if (auto* memObj = dynamic_cast<MemoryObject*>(object.get())) {
         assert(mDriver && "How do we have a memory object without a driver?");
         dataSize = memObj->data.mBufferSize;
-        memObjData.resize(dataSize);
+        if (memObj->data.mFlags & CL_MEM_HOST_NO_ACCESS)
+            throw CommandError("The host cannot access this object; it was created with 'host_no_access'.", objToken);
+        upload(*memObj);
         if (memObj->data.mDescriptor.image_width != 0) {
+            noteSynchronous();
+            memObjData.resize(dataSize);
             Driver::ImageCoords region;
             region[0] = memObj->data.mDescriptor.image_width;
             region[1] = memObj->data.mDescriptor.image_height;
@@ -93,15 +259,80 @@ void Testbench::executeSave(TokenStream& tokens)
                     region[1] = 1;
             }
             mDriver->readImage(*memObj, memObjData.data(), {}, region);
+            dataPtr = memObjData.data();
+        } else if (memObj->data.mFlags & (CL_MEM_USE_HOST_PTR | CL_MEM_ALLOC_HOST_PTR)) {
+            // The buffer lives in host memory, so write the file from a mapping rather than a copy.
+            noteSynchronous();
+            mapping.emplace(BufferMapping{*mDriver, *memObj});
+            mapping->mMapped = mDriver->mapBuffer(*memObj, CL_MAP_READ, 0, dataSize);
+            dataPtr = static_cast<const char*>(mapping->mMapped);
         } else {
-            mDriver->readBuffer(*memObj, memObjData.data(), 0, dataSize);
+#if CLTB_USE_LIBPNG
+            if (filepath.extension() == ".png" && mOptions.verbose)
+                *mOut << "A PNG filename was given, but object is not an image.  Writing raw data.\n";
+#endif // CLTB_USE_LIBPNG
+            if (mOptions.asyncSave) {
+                // The file is opened here, so that this command fails if it can't be.
+                std::shared_ptr<ChunkWriter> writer;
+                try {
+                    writer = std::make_shared<ChunkWriter>(filepath);
+                } catch (const std::system_error&) {
+                    throw CommandError([=](std::ostream& out) { out << "Could not open " << filepath << ".\n"; });
+                }
+                // The chunks are read and written as for a streamed save, but on a worker thread.  The
+                // worker drops the writer once done, which closes the file.
+                auto consume = [writer](const void* data, std::size_t offset, std::size_t size) {
+                    return writer->write(data, offset, size);
+                };
+                writer.reset();
+                std::shared_future<void> done;
+                try {
+                    done = mDriver->streamReadBufferAsync(*memObj, dataSize, std::move(consume));
+                } catch (...) {
+                    // The writer went with the consumer, so the file is closed.
+                    RemovePartialFile(filepath);
+                    throw;
+                }
+                SaveJob job{mNextSaveJob++, std::string(tokens.getTokenText(objToken)), filepath.string(), dataSize,
+                            object, std::move(done)};
+                if (mOptions.verbose) *mOut << "Started save job " << job.mId << ".\n";
+                mSaveJobs.push_back(std::move(job));
+                return;
+            }
+            // Large buffers are read in chunks, which are written to the file as later ones are read,
+            // instead of reading a copy of the whole buffer first.
+            std::optional<ChunkWriter> writer;
+            try {
+                writer.emplace(filepath);
+            } catch (const std::system_error&) {
+                throw CommandError([=](std::ostream& out) { out << "Could not open " << filepath << ".\n"; });
+            }
+            try {
+                mDriver->streamReadBuffer(*memObj, dataSize, [&](const void* data, std::size_t offset,
+                                                                 std::size_t size) {
+                    return writer->write(data, offset, size);
+                });
+            } catch (const std::system_error& e) {
+                // The file is closed before the partial data is removed.
+                writer.reset();
+                RemovePartialFile(filepath);
+                const std::string reason = e.what();
+                throw CommandError([=](std::ostream& out) {
+                    out << "Output error when writing to " << filepath << ": " << reason;
+                });
+            } catch (...) {
+                // The read failed, such as with a Driver::Error.
+                writer.reset();
+                RemovePartialFile(filepath);
+                throw;
+            }
+            return;
         }
-        dataPtr = memObjData.data();
 #if CLTB_USE_LIBPNG
         if (filepath.extension() == ".png") {
             if (memObj->data.mDescriptor.image_width != 0) {
                 ImageDataWrapper image;
-                image.mImageData = memObj->data;
+                image.mImageData = &memObj->data;
                 image.mData = dataPtr;
                 WritePNG(image, objToken, tokens.currentTextAsToken(), filename);
                 return;
@@ -110,8 +341,22 @@ void Testbench::executeSave(TokenStream& tokens)
             }
         }
 #endif // CLTB_USE_LIBPNG
+    } else if (auto* svmObj = dynamic_cast<SVMObject*>(object.get())) {
+        assert(mDriver && "How do we have an SVM allocation without a driver?");
+        noteSynchronous();
+        dataSize = svmObj->mSize;
+        if (svmObj->isFineGrained()) {
+            // The host reads the allocation directly, once the device is done with it on every queue.
+            finishQueues();
+        } else {
+            mDriver->mapSVM(svmObj->pointer(), CL_MAP_READ, dataSize);
+            svmMapping.emplace(SVMMapping{*mDriver, svmObj->pointer()});
+        }
+        dataPtr = static_cast<const char*>(svmObj->pointer());
     } else if (auto* progObj = dynamic_cast<ProgramObject*>(object.get())) {
         assert(mDriver && "How do we have a program object without a driver?");
+        noteSynchronous();
+        waitForBuild(*progObj);
         memObjData = mDriver->programBinary(*progObj);
 		dataPtr = memObjData.data();
 		dataSize = memObjData.size();
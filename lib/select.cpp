@@ -13,8 +13,10 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include <charconv>
 #include <iostream>
+#include <vector>
 
 #include "constant.hpp"
 #include "driver.hpp"
@@ -80,7 +82,40 @@ void Testbench::executeSelect(TokenStream& tokens)
                   << "\nResetting device to '" << deviceInfo.mName << "'\n";
         }
         mDriver->mPlatform = platforms[n];
-        mDriver->mDevice = devices[0];
+        mDriver->selectDevices({devices[0]});
+    } else if (command == "devices") {
+        // Several devices of the platform share a context, for split runs.
+        auto available = mDriver->getDeviceIDs(mDriver->mPlatform);
+        std::vector<cl_device_id> selected;
+        if (argumentToken.mType == Token::String && tokens.getTokenText(argumentToken) == "all") {
+            selected = available;
+        } else {
+            while (argumentToken.mType == Token::Constant) {
+                auto n = tokens.parseConstant<uint8_t>(argumentToken);
+                if (n >= available.size()) {
+                    throw CommandError(
+                        "Argument for 'select devices' out of range.  Use 'info device' for available options.",
+                        argumentToken);
+                }
+                if (std::find(selected.begin(), selected.end(), available[n]) != selected.end())
+                    throw CommandError("Device selected twice.", argumentToken);
+                selected.push_back(available[n]);
+                if (tokens.current().mType == Token::Comma) tokens.advance();
+                argumentToken = tokens.consume();
+            }
+            if (argumentToken.mType != Token::End)
+                throw CommandError("Expected device numbers or 'all' for 'select devices'.", argumentToken);
+        }
+        if (selected.empty()) throw CommandError("Expected device numbers or 'all' for 'select devices'.");
+
+        if (auto count = clearDriverObjects()) {
+            if (mOptions.verbose) *mOut << "Switching devices cleared " << count << " objects.\n";
+        }
+        if (mOptions.verbose) {
+            *mOut << "Selected " << selected.size() << " devices.  Device '"
+                  << mDriver->getDeviceInfo(selected.front()).mName << "' runs the default queue.\n";
+        }
+        mDriver->selectDevices(std::move(selected));
     } else if (command == "device") {
         if (argumentToken.mType == Token::End) {
             if (mOptions.verbose) *mOut << "Selected device: " << mDriver->getDeviceInfo(mDriver->mDevice) << '\n';
@@ -100,7 +135,7 @@ void Testbench::executeSelect(TokenStream& tokens)
             if (mOptions.verbose) *mOut << "Switching device cleared " << count << " objects.\n";
         }
         if (mOptions.verbose) *mOut << "Selected device '" << deviceInfo.mName << "'\n";
-        mDriver->mDevice = devices[n];
+        mDriver->selectDevices({devices[n]});
     } else {
         *mErr << "Invalid selection '" << command << "'.  Use 'help select' for info.\n";
         return;
@@ -0,0 +1,78 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <memory>
+
+#include "driver.hpp"
+#include "error.hpp"
+#include "object.hpp"
+#include "object_cl.hpp"
+#include "testbench.hpp"
+#include "token.hpp"
+
+using namespace CLTestbench;
+
+std::shared_ptr<Object> Testbench::evaluateSlice(TokenStream& tokens)
+{
+    if (!tokens.expect(Token::OpenParen))
+        throw CommandError("Expected '(' for 'slice' function.", tokens.current());
+
+    Token bufferToken = tokens.current();
+    std::shared_ptr<Object> object = evaluate(tokens);
+    auto* buffer = dynamic_cast<MemoryObject*>(object.get());
+    if (!buffer || buffer->data.mDescriptor.image_width != 0)
+        throw CommandError("Expected a buffer object for 'slice' function.", bufferToken);
+
+    if (!tokens.expect(Token::Comma)) throw CommandError("Expected ',' for 'slice' function.", tokens.current());
+    Token offsetToken = tokens.consume();
+    if (offsetToken.mType != Token::Constant) throw CommandError("Expected offset constant.", offsetToken);
+    const auto offset = tokens.parseConstant<std::size_t>(offsetToken);
+    if (offset >= buffer->data.mBufferSize) throw CommandError("Offset exceeds the buffer size.", offsetToken);
+
+    std::size_t length = buffer->data.mBufferSize - offset;
+    if (tokens.expect(Token::Comma)) {
+        Token lengthToken = tokens.consume();
+        if (lengthToken.mType != Token::Constant) throw CommandError("Expected length constant.", lengthToken);
+        length = tokens.parseConstant<std::size_t>(lengthToken);
+        if (length == 0 || offset + length > buffer->data.mBufferSize)
+            throw CommandError("Length is zero or exceeds the buffer size.", lengthToken);
+    }
+
+    if (!tokens.expect(Token::CloseParen))
+        throw CommandError("Expected ')' for 'slice' function.", tokens.current());
+
+    // Sub-buffers can't be created from sub-buffers, so slices of slices are made from the original buffer.
+    std::size_t parentOffset = offset;
+    if (buffer->data.mParent) {
+        parentOffset += buffer->data.mParentOffset;
+        object = buffer->data.mParent;
+        buffer = static_cast<MemoryObject*>(object.get());
+    }
+
+    const std::size_t alignment = mDriver->getBaseAddressAlignment();
+    if (alignment && parentOffset % alignment != 0) {
+        throw CommandError([=](std::ostream& out) {
+            out << "The slice must start at a multiple of " << alignment
+                << " bytes (CL_DEVICE_MEM_BASE_ADDR_ALIGN) within the buffer.";
+        }, offsetToken);
+    }
+
+    auto slice = mDriver->createSubBuffer(*buffer, parentOffset, length);
+    slice->data.mFlags = buffer->data.mFlags;
+    // The slice keeps the buffer, and any host memory it uses, alive.
+    slice->data.mParent = std::move(object);
+    return slice;
+}
@@ -0,0 +1,48 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "split.hpp"
+
+#include <cassert>
+#include <numeric>
+
+using namespace CLTestbench;
+
+std::vector<RangePart> CLTestbench::SplitRange(std::size_t size, const std::vector<uint32_t>& weights,
+                                               std::size_t granularity)
+{
+    assert(!weights.empty() && "Nothing to split the range across");
+    if (granularity == 0) granularity = 1;
+
+    const std::uint64_t total = std::accumulate(weights.begin(), weights.end(), std::uint64_t(0));
+    std::vector<RangePart> parts(weights.size());
+    std::uint64_t cumulative = 0;
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+        cumulative += weights[i];
+        std::size_t end = size;
+        if (i + 1 < weights.size()) {
+            // Computed in floating point, as size * cumulative may overflow.
+            const double share = total ? static_cast<double>(cumulative) / static_cast<double>(total) : 0.0;
+            end = static_cast<std::size_t>(static_cast<double>(size) * share) / granularity * granularity;
+            if (end < begin) end = begin;
+            if (end > size) end = size;
+        }
+        parts[i].mOffset = begin;
+        parts[i].mSize = end - begin;
+        begin = end;
+    }
+    return parts;
+}
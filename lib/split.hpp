@@ -0,0 +1,34 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace CLTestbench
+{
+/// A consecutive part of a range, as split by SplitRange.
+struct RangePart
+{
+    std::size_t mOffset = 0;
+    std::size_t mSize = 0;
+};
+
+/// Splits the range [0, size) into one consecutive part per weight, sized in proportion to the
+/// weights.  Parts start at multiples of the granularity, so that they hold whole work-groups,
+/// and the last part receives any remainder.  Parts may be empty.
+std::vector<RangePart> SplitRange(std::size_t size, const std::vector<uint32_t>& weights, std::size_t granularity);
+} // namespace CLTestbench
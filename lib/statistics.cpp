@@ -0,0 +1,70 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+#include "statistics.hpp"
+
+using namespace CLTestbench;
+
+namespace
+{
+/// Percentile P (0 to 100) of a sorted, non-empty, sample list.
+double Percentile(const std::vector<double>& sorted, double p) noexcept
+{
+    assert(!sorted.empty());
+    const double rank = (p / 100.0) * static_cast<double>(sorted.size() - 1);
+    const auto lower = static_cast<std::size_t>(std::floor(rank));
+    const auto upper = std::min(lower + 1, sorted.size() - 1);
+    const double fraction = rank - static_cast<double>(lower);
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+}
+} // namespace
+
+Statistics CLTestbench::ComputeStatistics(std::vector<double> samples)
+{
+    Statistics stats;
+    if (samples.empty()) return stats;
+
+    std::sort(samples.begin(), samples.end());
+    const double count = static_cast<double>(samples.size());
+
+    stats.mMin = samples.front();
+    stats.mMax = samples.back();
+    stats.mMean = std::accumulate(samples.begin(), samples.end(), 0.0) / count;
+    stats.mMedian = Percentile(samples, 50);
+    stats.mP95 = Percentile(samples, 95);
+    stats.mP99 = Percentile(samples, 99);
+
+    if (samples.size() > 1) {
+        double squares = 0;
+        for (double sample : samples) squares += (sample - stats.mMean) * (sample - stats.mMean);
+        stats.mStdDev = std::sqrt(squares / (count - 1));
+    }
+
+    return stats;
+}
+
+std::string CLTestbench::FormatNanoseconds(double nanoseconds)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3) << (nanoseconds / 1000.0) << " us";
+    return out.str();
+}
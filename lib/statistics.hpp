@@ -0,0 +1,41 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <string>
+#include <vector>
+
+namespace CLTestbench
+{
+/// Summary of a set of timing samples.
+struct Statistics
+{
+    double mMin = 0;
+    double mMax = 0;
+    double mMean = 0;
+    double mMedian = 0;
+    double mP95 = 0;
+    double mP99 = 0;
+    /// Sample standard deviation.  Zero if there are fewer than two samples.
+    double mStdDev = 0;
+};
+
+/// Computes the summary of the given samples.
+/// Percentiles are linearly interpolated between the closest ranks.
+Statistics ComputeStatistics(std::vector<double> samples);
+
+/// Formats a duration given in nanoseconds as microseconds.
+std::string FormatNanoseconds(double);
+} // namespace CLTestbench
@@ -0,0 +1,162 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "driver.hpp"
+#include "error.hpp"
+#include "istringview.hpp"
+#include "statistics.hpp"
+#include "table.hpp"
+#include "testbench.hpp"
+#include "token.hpp"
+
+using namespace CLTestbench;
+
+namespace
+{
+std::string FormatTime(cl_ulong nanoseconds)
+{
+    return FormatNanoseconds(static_cast<double>(nanoseconds));
+}
+
+/// The bytes moved, the time taken and the effective rate, as a sentence.
+std::string FormatThroughput(std::uint64_t bytes, std::chrono::steady_clock::duration time)
+{
+    const double seconds = std::chrono::duration<double>(time).count();
+    std::ostringstream out;
+    out << bytes << " bytes in " << FormatNanoseconds(seconds * 1e9) << ", " << std::fixed << std::setprecision(2)
+        << (seconds > 0 ? static_cast<double>(bytes) / seconds / 1e9 : 0.0) << " GB/s.\n";
+    return out.str();
+}
+
+/// Difference between two device timestamps.  Some implementations report
+/// zero for timestamps they don't track, so never underflow.
+cl_ulong Elapsed(cl_ulong from, cl_ulong to) noexcept
+{
+    return to > from ? to - from : 0;
+}
+} // namespace
+
+void Testbench::printTransferStats()
+{
+    const Driver::TransferStats& transfers = mDriver->getTransferStats();
+    if (!transfers.mCopiedToDevice && !transfers.mCopiedFromDevice && !transfers.mMappedToDevice &&
+        !transfers.mMappedFromDevice)
+        return;
+
+    const std::string cells[] = {
+        std::to_string(transfers.mCopiedToDevice), std::to_string(transfers.mCopiedFromDevice),
+        std::to_string(transfers.mMappedToDevice), std::to_string(transfers.mMappedFromDevice)};
+    Util::Table table(3, 2);
+    table.setHeader({"Transfer", "To device (bytes)", "From device (bytes)"});
+    table[0][0] = "copy";
+    table[0][1] = cells[0];
+    table[0][2] = cells[1];
+    table[1][0] = "map";
+    table[1][1] = cells[2];
+    table[1][2] = cells[3];
+    *mOut << table;
+
+    if (transfers.mStreamedToDevice)
+        *mOut << "Streamed uploads: " << FormatThroughput(transfers.mStreamedToDevice, transfers.mStreamToDeviceTime);
+    if (transfers.mStreamedFromDevice)
+        *mOut << "Streamed readbacks: "
+              << FormatThroughput(transfers.mStreamedFromDevice, transfers.mStreamFromDeviceTime);
+}
+
+void Testbench::executeStats(TokenStream& tokens)
+{
+    if (!mDriver) throw CommandError("A driver is required for a 'stats' command.");
+
+    if (tokens) {
+        Token token = tokens.consume();
+        IStringView option = tokens.getTokenText(token);
+        if (option.autocomplete({"clear"}) != 0) throw CommandError("Unknown 'stats' option.", token);
+        mDriver->clearProfile();
+        if (tokens && mOptions.verbose) *mOut << "Trailing tokens on 'stats' command ignored.\n";
+        return;
+    }
+
+    printTransferStats();
+
+    const auto& entries = mDriver->getProfile();
+    if (entries.empty()) {
+        if (mOptions.verbose) {
+            *mOut << "No profiled commands.";
+            if (!mDriver->isProfiling()) *mOut << "  Use 'set profile on' to enable profiling.";
+            *mOut << '\n';
+        }
+        return;
+    }
+
+    // The table only holds views, so the formatted text must outlive it.
+    std::vector<std::string> cells;
+    constexpr unsigned Columns = 6;
+    cells.reserve(entries.size() * Columns);
+
+    Util::Table table(Columns, entries.size());
+    table.setHeader({"#", "Command", "Start", "Queued", "Submitted", "Duration"});
+    // With synchronised clocks, every device's commands are placed on the host timeline, which
+    // starts when the first command was enqueued.  Otherwise, the first command's device clock is used.
+    const bool hostTimeline = std::all_of(entries.begin(), entries.end(),
+                                          [](const auto& entry) { return entry.mHostStart.has_value(); });
+    const cl_ulong origin = entries.front().mQueued;
+    const auto hostOrigin = entries.front().mHostEnqueued;
+    cl_ulong total = 0;
+    for (unsigned row = 0; row < entries.size(); ++row) {
+        const auto& entry = entries[row];
+        const cl_ulong duration = Elapsed(entry.mStart, entry.mEnd);
+        total += duration;
+
+        cells.push_back(std::to_string(row));
+        table[row][0] = cells.back();
+        table[row][1] = entry.mCommand;
+        if (hostTimeline) {
+            const auto start = std::chrono::duration_cast<std::chrono::nanoseconds>(*entry.mHostStart - hostOrigin);
+            cells.push_back(FormatNanoseconds(static_cast<double>(std::max<int64_t>(0, start.count()))));
+        } else {
+            cells.push_back(FormatTime(Elapsed(origin, entry.mStart)));
+        }
+        table[row][2] = cells.back();
+        cells.push_back(FormatTime(Elapsed(entry.mQueued, entry.mSubmit)));
+        table[row][3] = cells.back();
+        cells.push_back(FormatTime(Elapsed(entry.mSubmit, entry.mStart)));
+        table[row][4] = cells.back();
+        cells.push_back(FormatTime(duration));
+        table[row][5] = cells.back();
+    }
+
+    *mOut << table << "Total device time: " << FormatTime(total) << '\n';
+    if (mOptions.verbose) {
+        if (hostTimeline) {
+            *mOut << "'Start' is on the host clock, relative to the first command being enqueued, so it\n"
+                     "includes the time the testbench spent between commands.";
+            if (const ClockSync* sync = mDriver->getClockSync(entries.front().mDevice))
+                *mOut << "  Device clock drift: " << sync->driftPPM() << " ppm.";
+            *mOut << '\n';
+        } else {
+            *mOut << "'Start' is relative to the first command being queued.";
+        }
+        *mOut << "  'Queued' is the time spent waiting for submission, and 'Submitted' the time\n"
+                 "from submission until execution.\n";
+    }
+}
@@ -0,0 +1,101 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstring>
+#include <memory>
+
+#include "driver.hpp"
+#include "error.hpp"
+#include "istringview.hpp"
+#include "object.hpp"
+#include "object_cl.hpp"
+#include "object_data.hpp"
+#include "testbench.hpp"
+#include "token.hpp"
+
+using namespace CLTestbench;
+
+namespace
+{
+const std::initializer_list<std::string_view> SVMFlagNames{"coarse", "fine", "atomics"};
+}
+
+std::shared_ptr<Object> Testbench::evaluateSVM(TokenStream& tokens)
+{
+    if (!tokens.expect(Token::OpenParen)) throw CommandError("Expected '(' for 'svm' function.", tokens.current());
+
+    // The size, or a data object with the initial contents.
+    std::shared_ptr<Object> evaluated;
+    DataObject* data = nullptr;
+    std::size_t size = 0;
+    Token sizeToken = tokens.current();
+    if (sizeToken.mType == Token::Constant) {
+        size = tokens.parseConstant<std::size_t>(tokens.consume());
+    } else {
+        evaluated = evaluate(tokens);
+        data = dynamic_cast<DataObject*>(evaluated.get());
+        if (!data) throw CommandError("Expected size constant or data object.", sizeToken);
+        size = data->size();
+    }
+    if (size == 0) throw CommandError("SVM allocations may not be empty.", sizeToken);
+
+    bool fine = false;
+    bool atomics = false;
+    Token fineToken;
+    while (tokens.current().mType == Token::Comma) {
+        tokens.advance();
+        Token flagToken = tokens.consume();
+        if (flagToken.mType != Token::String) throw CommandError("Expected SVM flag.", flagToken);
+        switch (IStringView(tokens.getTokenText(flagToken)).autocomplete(SVMFlagNames)) {
+        case 0: fine = false; break;
+        case 1:
+            fine = true;
+            fineToken = flagToken;
+            break;
+        case 2: atomics = true; break;
+        case IStringView::ambiguous: throw CommandError("Ambiguous SVM flag.", flagToken);
+        default: throw CommandError("Unknown SVM flag.", flagToken);
+        }
+    }
+    if (atomics && !fine) throw CommandError("SVM atomics require a 'fine' allocation.", tokens.current());
+
+    if (!tokens.expect(Token::CloseParen)) throw CommandError("Expected ')' for 'svm' function.", tokens.current());
+
+    // Check the device's support up front, as clSVMAlloc doesn't say why it failed.
+    const cl_device_svm_capabilities capabilities = mDriver->getSVMCapabilities();
+    if (!(capabilities & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER))
+        throw CommandError("The device does not support shared virtual memory.", sizeToken);
+    if (fine && !(capabilities & CL_DEVICE_SVM_FINE_GRAIN_BUFFER))
+        throw CommandError("The device does not support fine-grained SVM buffers.", fineToken);
+    if (atomics && !(capabilities & CL_DEVICE_SVM_ATOMICS))
+        throw CommandError("The device does not support SVM atomics.", fineToken);
+
+    cl_svm_mem_flags flags = CL_MEM_READ_WRITE;
+    if (fine) flags |= CL_MEM_SVM_FINE_GRAIN_BUFFER;
+    if (atomics) flags |= CL_MEM_SVM_ATOMICS;
+    auto svm = mDriver->allocateSVM(size, flags);
+
+    if (data) {
+        // The allocation is new, so the device can't be using it yet.
+        if (svm->isFineGrained()) {
+            std::memcpy(svm->pointer(), data->data(), size);
+        } else {
+            mDriver->mapSVM(svm->pointer(), CL_MAP_WRITE_INVALIDATE_REGION, size);
+            std::memcpy(svm->pointer(), data->data(), size);
+            mDriver->unmapSVM(svm->pointer());
+        }
+    }
+    return svm;
+}
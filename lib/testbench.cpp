@@ -15,7 +15,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <iostream>
+#include <vector>
 
 #include "testbench.hpp"
 
@@ -25,8 +27,10 @@
 #include "istringview.hpp"
 #include "object.hpp"
 #include "object_cl.hpp"
+#include "programcache.hpp"
 #include "table.hpp"
 #include "token.hpp"
+#include "tuning.hpp"
 
 using namespace CLTestbench;
 
@@ -71,6 +75,22 @@ Testbench::Result Testbench::run(std::string_view line)
 }
 
 Testbench::Result Testbench::run(TokenStream& tokens)
+{
+    // Commands are timed while tracing, as the host side of the timeline.
+    if (!mTrace) return runCommand(tokens);
+    const auto start = std::chrono::steady_clock::now();
+    Result result;
+    try {
+        result = runCommand(tokens);
+    } catch (...) {
+        traceCommand(tokens.text(), start);
+        throw;
+    }
+    traceCommand(tokens.text(), start);
+    return result;
+}
+
+Testbench::Result Testbench::runCommand(TokenStream& tokens)
 {
     if (!tokens) return Result::Good;
 
@@ -124,6 +144,14 @@ Testbench::Result Testbench::run(TokenStream& tokens)
     case Command::Flush: executeFlush(tokens); break;
     case Command::Bind: executeBind(tokens); break;
     case Command::Help: executeHelp(tokens); break;
+    case Command::Stats: executeStats(tokens); break;
+    case Command::Bench: executeBench(tokens); break;
+    case Command::Tune: executeTune(tokens); break;
+    case Command::Fill: executeFill(tokens); break;
+    case Command::Migrate: executeMigrate(tokens); break;
+    case Command::Rerun: executeRerun(tokens); break;
+    case Command::Trace: executeTrace(tokens); break;
+    case Command::Jobs: executeJobs(tokens); break;
     case Command::Quit:
         if (tokens) *mErr << "Trailing tokens after 'quit' command ignored.\n";
         return Result::Quit;
@@ -178,6 +206,9 @@ void Testbench::executeLoad(TokenStream& tokens)
 
 unsigned Testbench::clearDriverObjects() noexcept
 {
+    // Save jobs hold objects, and their reads use the driver.
+    waitForSaveJobs();
+    mLastLaunches.clear();
     unsigned count = 0;
     for (auto it = mObjects.begin(); it != mObjects.end();) {
         Object* obj = it->second.get();
@@ -236,14 +267,61 @@ void Testbench::executeWait(TokenStream& tokens)
 {
     if (!mDriver) throw CommandError("A driver is required for a 'wait' command.");
 
+    if (Token token = tokens.current(); token.mType == Token::String && tokens.getTokenText(token) == "jobs" &&
+                                        mObjects.find("jobs") == mObjects.end()) {
+        tokens.advance();
+        if (tokens) throw CommandError("Trailing tokens after 'wait jobs' not allowed.", tokens.current());
+        if (!waitForSaveJobs()) throw CommandError("Some save jobs failed.");
+        return;
+    }
+
+    if (!tokens) {
+        finishQueues();
+        return;
+    }
+
+    std::vector<cl_event> events;
+    do {
+        Token token = tokens.current();
+        auto object = evaluate(tokens);
+        if (auto* event = dynamic_cast<EventObject*>(object.get())) {
+            events.push_back(*event);
+        } else if (auto* queue = dynamic_cast<QueueObject*>(object.get())) {
+            mDriver->finish(*queue);
+        } else {
+            throw CommandError("Expected event or queue object.", token);
+        }
+        if (tokens.current().mType == Token::Comma) tokens.advance();
+    } while (tokens);
+    mDriver->waitForEvents(events);
+}
+
+void Testbench::finishQueues()
+{
     mDriver->finish();
-    if (tokens && mOptions.verbose) *mOut << "Trailing tokens on 'wait' command ignored.\n";
+    for (const auto& pair : mObjects) {
+        if (auto* queue = dynamic_cast<QueueObject*>(pair.second.get())) mDriver->finish(*queue);
+    }
 }
 
 void Testbench::executeFlush(TokenStream& tokens)
 {
     if (!mDriver) throw CommandError("A driver is required for a 'flush' command.");
 
-    mDriver->flush();
-    if (tokens && mOptions.verbose) *mOut << "Trailing tokens on 'flush' command ignored.\n";
+    if (!tokens) {
+        mDriver->flush();
+        for (const auto& pair : mObjects) {
+            if (auto* queue = dynamic_cast<QueueObject*>(pair.second.get())) mDriver->flush(*queue);
+        }
+        return;
+    }
+
+    do {
+        Token token = tokens.current();
+        auto object = evaluate(tokens);
+        auto* queue = dynamic_cast<QueueObject*>(object.get());
+        if (!queue) throw CommandError("Expected queue object.", token);
+        mDriver->flush(*queue);
+        if (tokens.current().mType == Token::Comma) tokens.advance();
+    } while (tokens);
 }
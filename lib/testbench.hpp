@@ -14,18 +14,28 @@
 // along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
 
 #pragma once
+#include <array>
+#include <chrono>
 #include <cstdint>
+#include <future>
 #include <iosfwd>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
+
+#include "chrometrace.hpp"
 
 namespace CLTestbench
 {
 class Driver;
 class TokenStream;
+struct Token;
 class Object;
+class LocalSizeCache;
+class ProgramCache;
 
 class Testbench final
 {
@@ -82,6 +92,8 @@ private:
     void executeLoad(TokenStream&);
     void executeSelect(TokenStream&);
     void executeInfo(TokenStream&);
+    /// Shows the memory objects in the driver's memory ledger, for 'info memory'.
+    void showMemory();
     void executeList(TokenStream&);
     void executeSet(TokenStream&);
     void executeRelease(TokenStream&);
@@ -92,6 +104,137 @@ private:
     void executeWait(TokenStream&);
     void executeScript(TokenStream&);
     void executeHelp(TokenStream&);
+    void executeStats(TokenStream&);
+    /// Prints the bytes moved per transfer path, if any, for 'stats'.
+    void printTransferStats();
+    void executeBench(TokenStream&);
+    void executeTune(TokenStream&);
+    void executeFill(TokenStream&);
+    void executeMigrate(TokenStream&);
+    void executeRerun(TokenStream&);
+    void executeTrace(TokenStream&);
+    void executeJobs(TokenStream&);
+
+    /// Runs a command, without timing it for a trace.
+    Result runCommand(TokenStream&);
+
+    /// A timeline being recorded by 'trace start'.
+    struct TraceSession
+    {
+        std::string mFilename;
+        std::chrono::steady_clock::time_point mStart;
+        /// Commands run on the testbench, timed on the host.
+        std::vector<TraceEvent> mCommands;
+        /// Whether profiling was enabled before the trace enabled it.
+        bool mWasProfiling = false;
+    };
+    std::unique_ptr<TraceSession> mTrace;
+    /// Adds the command, which started at the given time, to the trace, if one is active.
+    void traceCommand(std::string_view command, std::chrono::steady_clock::time_point start);
+
+    /// A 'save' writing its file in the background, with 'set asyncsave on'.
+    struct SaveJob
+    {
+        unsigned mId;
+        std::string mObjectName;
+        std::string mFilename;
+        std::size_t mSize;
+        /// The saved object, which is kept alive until the job is forgotten.
+        std::shared_ptr<Object> mObject;
+        /// Ready once the file is written.  This rethrows the errors of the read or the write.
+        std::shared_future<void> mDone;
+    };
+    /// Save jobs which haven't been reported as done by 'jobs' or 'wait jobs' yet.
+    std::vector<SaveJob> mSaveJobs;
+    unsigned mNextSaveJob = 1;
+    /// Reports an error of the job, which must be done.  Returns whether the job succeeded.
+    bool reportSaveJob(const SaveJob&);
+    /// Waits for every save job, reporting their errors, and forgets them.  Returns whether all succeeded.
+    bool waitForSaveJobs();
+
+    /// Waits for the commands of the default and device queues, and of the queue objects in variables.
+    void finishQueues();
+
+    /// Fills a region of the buffer, which must be a MemoryObject, on the device.
+    /// The pattern must be a data object suitable for clEnqueueFillBuffer.
+    void fill(Object& buffer, const Object& pattern, const Token& patternToken, std::size_t offset,
+              std::size_t size);
+
+    /// Writes the data of a buffer created in lazy upload mode, if it isn't written yet.  This must
+    /// precede any use of the memory object by the device or the host.  Sub-buffers write their buffer.
+    void upload(Object& memoryObject);
+
+    /// Throws if allocating a memory object of this size would exceed CL_DEVICE_MAX_MEM_ALLOC_SIZE,
+    /// or bring the live memory objects over CL_DEVICE_GLOBAL_MEM_SIZE.
+    void checkAllocation(std::size_t size, const Token& token);
+
+    /// A kernel enqueue parsed from a 'run'-like command.
+    struct Launch
+    {
+        /// The kernel object.  This is always a KernelObject.
+        std::shared_ptr<Object> mKernel;
+        std::array<std::size_t, 3> mGlobal{};
+        std::optional<std::array<std::size_t, 3>> mLocal;
+        /// The global work offset, if any.
+        std::optional<std::array<std::size_t, 3>> mOffset;
+        /// The queue to run on, which is a QueueObject, or null for the default queue.
+        std::shared_ptr<Object> mQueue;
+        /// Events to wait for before running.  These are EventObjects.
+        std::vector<std::shared_ptr<Object>> mWaitFor;
+        /// Whether the global range is split across the selected devices, in proportion to mWeights.
+        bool mSplit = false;
+        std::vector<uint32_t> mWeights;
+    };
+
+    /// Evaluates the next argument of a 'run' or 'bind' command and binds it to the kernel, which
+    /// must be a KernelObject.  Constants are converted using the kernel's argument metadata.
+    void bindArgument(Object& kernel, uint32_t argIndex, TokenStream&);
+
+    /// Parses "KERNEL((SIZE), [(LOCAL_SIZE)], [(OFFSET),] ARGS...)", binding ARGS to the kernel.
+    Launch parseLaunch(TokenStream&);
+    /// Parses the optional "on QUEUE", "after EVENTS..." and "split [WEIGHTS...]" clauses of a 'run' command.
+    void parseLaunchOrder(TokenStream&, Launch&);
+    /// Enqueues the launch of a 'run' command.  If requested, its EventObject is returned.
+    std::shared_ptr<Object> enqueueLaunch(Launch&, bool wantEvent);
+
+    /// A launch kept for 'rerun'.  It doesn't keep its kernel, queue or events alive.
+    struct LastLaunch
+    {
+        /// The sizes and split of the launch, without its objects.
+        Launch mLaunch;
+        std::weak_ptr<Object> mKernel;
+        /// Set if the launch ran on a queue object.
+        std::optional<std::weak_ptr<Object>> mQueue;
+        std::vector<std::weak_ptr<Object>> mWaitFor;
+    };
+    /// The last launch of each kernel by 'run', most recent last, for 'rerun'.
+    std::vector<LastLaunch> mLastLaunches;
+    void rememberLaunch(Launch&&);
+
+    /// Device and host times, in nanoseconds, of each timed launch.
+    struct LaunchTimings
+    {
+        std::vector<double> mDevice;
+        std::vector<double> mHost;
+    };
+
+    /// Runs the launch 'warmup' times, then 'iterations' timed times, each waiting for the previous.
+    /// Profiling must be enabled.
+    LaunchTimings timeLaunch(const Launch&, uint32_t iterations, uint32_t warmup);
+
+    /// Results of previous 'tune' commands, loaded on first use.
+    std::unique_ptr<LocalSizeCache> mLocalSizes;
+    LocalSizeCache& getLocalSizeCache();
+    /// The tuned local size for this launch on the selected device, if any.
+    std::optional<std::array<std::size_t, 3>> findTunedLocalSize(const Launch&);
+
+    /// Binaries of programs built from source, created on first use.
+    std::unique_ptr<ProgramCache> mProgramCache;
+    ProgramCache& getProgramCache();
+
+    /// Waits for an asynchronous build of the program, which must be a ProgramObject.
+    /// A build failure is reported with its log and rethrown.
+    void waitForBuild(Object& program);
 
     /// Evaluate a "buffer" directive.
     std::shared_ptr<Object> evaluateBuffer(TokenStream&);
@@ -107,14 +250,28 @@ private:
     std::shared_ptr<Object> evaluateImage(TokenStream&);
     /// Evaluate a "clone" directive.
     std::shared_ptr<Object> evaluateClone(TokenStream&);
+    /// Evaluate a "slice" directive.
+    std::shared_ptr<Object> evaluateSlice(TokenStream&);
+    /// Evaluate a "svm" directive.
+    std::shared_ptr<Object> evaluateSVM(TokenStream&);
+    /// Evaluate a "queue" directive.
+    std::shared_ptr<Object> evaluateQueue(TokenStream&);
+    /// Evaluate a "run" directive, which returns the launch's event.
+    std::shared_ptr<Object> evaluateRun(TokenStream&);
 
     struct Options
     {
         bool verbose : 1;
         bool caretPrint : 1;
         bool scriptEcho : 1;
+        bool programCache : 1;
+        bool asyncBuild : 1;
+        bool lazyUpload : 1;
+        bool asyncSave : 1;
 
-        Options() : verbose(true), caretPrint(true), scriptEcho(false) {}
+        Options() :
+            verbose(true), caretPrint(true), scriptEcho(false), programCache(false), asyncBuild(false),
+            lazyUpload(false), asyncSave(false) {}
     } mOptions;
 
     /// Nesting level for scripts.
@@ -0,0 +1,161 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "chrometrace.hpp"
+#include "clocksync.hpp"
+#include "driver.hpp"
+#include "error.hpp"
+#include "istringview.hpp"
+#include "testbench.hpp"
+#include "token.hpp"
+
+using namespace CLTestbench;
+
+namespace
+{
+int64_t Nanoseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+/// Places the device commands on the host timeline, with one track per queue after the first track.
+void AddDeviceEvents(std::vector<TraceEvent>& events, std::vector<std::string>& tracks,
+                     const std::vector<Driver::ProfileEntry>& entries, std::chrono::steady_clock::time_point start)
+{
+    std::vector<cl_command_queue> queues;
+    for (const auto& entry : entries) {
+        if (std::find(queues.begin(), queues.end(), entry.mQueue) == queues.end()) queues.push_back(entry.mQueue);
+    }
+
+    for (std::size_t queue = 0; queue < queues.size(); ++queue) {
+        const uint32_t track = static_cast<uint32_t>(tracks.size());
+        tracks.push_back("Queue " + std::to_string(queue));
+
+        // Commands mapped by the driver's clock synchronisation are already on the host clock.
+        // Otherwise, each queue may belong to a device with its own clock, estimated from the
+        // enqueue times.
+        std::vector<ClockPair> pairs;
+        for (const auto& entry : entries) {
+            if (entry.mQueue == queues[queue] && !entry.mHostStart)
+                pairs.push_back({Nanoseconds(entry.mHostEnqueued - start), entry.mQueued});
+        }
+        const int64_t offset = EstimateDeviceToHostOffset(pairs);
+
+        for (const auto& entry : entries) {
+            if (entry.mQueue != queues[queue]) continue;
+            TraceEvent event;
+            event.mName = entry.mCommand;
+            event.mCategory = "device";
+            event.mTrack = track;
+            int64_t eventStart = static_cast<int64_t>(entry.mStart) + offset;
+            event.mDuration = entry.mEnd > entry.mStart ? entry.mEnd - entry.mStart : 0;
+            if (entry.mHostStart && entry.mHostEnd) {
+                eventStart = Nanoseconds(*entry.mHostStart - start);
+                event.mDuration = static_cast<uint64_t>(std::max<int64_t>(0, Nanoseconds(*entry.mHostEnd -
+                                                                                         *entry.mHostStart)));
+            }
+            event.mStart = static_cast<uint64_t>(std::max<int64_t>(0, eventStart));
+            events.push_back(std::move(event));
+        }
+    }
+}
+} // namespace
+
+void Testbench::traceCommand(std::string_view command, std::chrono::steady_clock::time_point start)
+{
+    if (!mTrace) return;
+    const auto end = std::chrono::steady_clock::now();
+    TraceEvent event;
+    event.mName = std::string(TrimWhitespace(command));
+    event.mCategory = "command";
+    event.mStart = static_cast<uint64_t>(std::max<int64_t>(0, Nanoseconds(start - mTrace->mStart)));
+    event.mDuration = static_cast<uint64_t>(Nanoseconds(end - start));
+    mTrace->mCommands.push_back(std::move(event));
+}
+
+void Testbench::executeTrace(TokenStream& tokens)
+{
+    Token actionToken = tokens.consume();
+    if (actionToken.mType == Token::End) {
+        if (mTrace) *mOut << "Tracing to " << mTrace->mFilename << ".\n";
+        else *mOut << "No trace is being recorded.\n";
+        return;
+    }
+
+    IStringView action = tokens.getTokenText(actionToken);
+    switch (action.autocomplete({"start", "stop"})) {
+    case 0: {
+        if (mTrace) throw CommandError("A trace is already being recorded.  Use 'trace stop' first.", actionToken);
+        auto filename = TrimWhitespace(tokens.currentText());
+        if (filename.empty()) throw CommandError("Expected a file name for 'trace start'.");
+        // Fail now, rather than once the trace is recorded.
+        std::filesystem::path filepath(filename);
+        if (!std::ofstream(filepath).is_open()) {
+            throw CommandError([=](std::ostream& out) { out << "Could not open " << filepath << ".\n"; });
+        }
+
+        auto trace = std::make_unique<TraceSession>();
+        trace->mFilename = std::string(filename);
+        if (mDriver) {
+            // The device timings come from profiling events.
+            trace->mWasProfiling = mDriver->isProfiling();
+            mDriver->setProfiling(true);
+            mDriver->startTrace();
+        }
+        trace->mStart = std::chrono::steady_clock::now();
+        mTrace = std::move(trace);
+        if (mOptions.verbose) *mOut << "Tracing to " << filepath << ".\n";
+        break;
+    }
+    case 1: {
+        if (!mTrace) throw CommandError("No trace is being recorded.", actionToken);
+        auto trace = std::move(mTrace);
+        std::vector<Driver::ProfileEntry> entries;
+        if (mDriver) {
+            entries = mDriver->stopTrace();
+            mDriver->setProfiling(trace->mWasProfiling);
+        }
+
+        std::vector<std::string> tracks{"Testbench commands"};
+        std::vector<TraceEvent> events = std::move(trace->mCommands);
+        const std::size_t commandCount = events.size();
+        AddDeviceEvents(events, tracks, entries, trace->mStart);
+
+        std::filesystem::path filepath(trace->mFilename);
+        std::ofstream file(filepath);
+        if (!file.is_open()) {
+            throw CommandError([=](std::ostream& out) { out << "Could not open " << filepath << ".\n"; });
+        }
+        WriteChromeTrace(file, events, tracks);
+        if (file.fail()) {
+            *mErr << "Output error when writing to " << filepath << '\n';
+            return;
+        }
+        if (mOptions.verbose) {
+            *mOut << "Wrote " << commandCount << " commands and " << entries.size() << " device commands to "
+                  << filepath << ".\n";
+        }
+        break;
+    }
+    default:
+        throw CommandError("Expected 'start FILE' or 'stop' for 'trace'.", actionToken);
+    }
+}
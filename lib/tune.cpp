@@ -0,0 +1,151 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cache.hpp"
+#include "driver.hpp"
+#include "error.hpp"
+#include "object_cl.hpp"
+#include "statistics.hpp"
+#include "table.hpp"
+#include "testbench.hpp"
+#include "token.hpp"
+#include "tuning.hpp"
+
+using namespace CLTestbench;
+
+namespace
+{
+LocalSizeCache::Key MakeKey(Driver& driver, KernelObject& kernel, const Driver::EnqueueSize& global)
+{
+    const Driver::DeviceInfo& info = driver.getSelectedDeviceInfo();
+    LocalSizeCache::Key key;
+    // The queried strings may carry their null terminators.
+    key.mDevice = info.mName.c_str();
+    key.mDriverVersion = info.mDriverVersion.c_str();
+    key.mKernel = kernel.data.mName;
+    key.mGlobal = global;
+    return key;
+}
+
+std::string FormatSize(const Driver::EnqueueSize& size)
+{
+    std::ostringstream out;
+    out << '(' << size[0];
+    if (size[1]) out << ", " << size[1];
+    if (size[2]) out << ", " << size[2];
+    out << ')';
+    return out.str();
+}
+} // namespace
+
+LocalSizeCache& Testbench::getLocalSizeCache()
+{
+    if (!mLocalSizes) {
+        std::filesystem::path directory = CacheDirectory();
+        mLocalSizes = std::make_unique<LocalSizeCache>(directory.empty() ? directory : directory / "localsizes");
+    }
+    return *mLocalSizes;
+}
+
+std::optional<Driver::EnqueueSize> Testbench::findTunedLocalSize(const Launch& launch)
+{
+    // Don't build a key unless something was ever tuned.
+    LocalSizeCache& cache = getLocalSizeCache();
+    if (cache.empty()) return std::nullopt;
+    return cache.find(MakeKey(*mDriver, static_cast<KernelObject&>(*launch.mKernel), launch.mGlobal));
+}
+
+void Testbench::executeTune(TokenStream& tokens)
+{
+    if (!mDriver)
+        throw CommandError("An OpenCL implementation must be loaded for a 'tune' command.");
+
+    Token launchToken = tokens.current();
+    Launch launch = parseLaunch(tokens);
+    auto& kernel = static_cast<KernelObject&>(*launch.mKernel);
+    if (launch.mLocal)
+        throw CommandError("The local size is what 'tune' selects; it must not be given.", launchToken);
+
+    uint32_t iterations = 20;
+    if (tokens) {
+        Token token = tokens.consume();
+        if (token.mType != Token::Constant) throw CommandError("Expected constant.", token);
+        iterations = tokens.parseConstant<uint32_t>(token);
+        if (iterations == 0) throw CommandError("At least one iteration is required.", token);
+    }
+    if (tokens && mOptions.verbose) *mOut << "Trailing tokens on 'tune' command ignored.\n";
+
+    const std::vector<Driver::EnqueueSize> candidates =
+        LocalSizeCandidates(launch.mGlobal, mDriver->getKernelLimits(kernel));
+    if (candidates.empty())
+        throw CommandError("No local size is valid for this kernel and global size.", launchToken);
+
+    Driver::ProfilingGuard profiling(*mDriver);
+
+    struct Result
+    {
+        Driver::EnqueueSize mLocal;
+        double mDevice;
+        double mHost;
+    };
+    std::vector<Result> results;
+    results.reserve(candidates.size());
+    for (const Driver::EnqueueSize& local : candidates) {
+        launch.mLocal = local;
+        try {
+            LaunchTimings timings = timeLaunch(launch, iterations, 2);
+            results.push_back({local, ComputeStatistics(std::move(timings.mDevice)).mMedian,
+                               ComputeStatistics(std::move(timings.mHost)).mMedian});
+        } catch (const Driver::Error& e) {
+            // The kernel's resource usage may rule out sizes within the reported limits.
+            if (mOptions.verbose) *mOut << "Skipping local size " << FormatSize(local) << ": " << e.what() << '\n';
+        }
+    }
+    if (results.empty()) throw CommandError("The kernel failed to run with every candidate local size.");
+
+    // Rank by device time, using the host time to break ties (such as when timings are unavailable).
+    const Result* best = &results.front();
+    for (const Result& result : results) {
+        if (result.mDevice < best->mDevice || (result.mDevice == best->mDevice && result.mHost < best->mHost))
+            best = &result;
+    }
+
+    if (mOptions.verbose) {
+        // The table only holds views, so the formatted text must outlive it.
+        std::vector<std::string> cells;
+        cells.reserve(results.size() * 3);
+        Util::Table table(3, results.size());
+        table.setHeader({"Local size", "Device median", "Host median"});
+        for (unsigned row = 0; row < results.size(); ++row) {
+            cells.push_back(FormatSize(results[row].mLocal));
+            table[row][0] = cells.back();
+            cells.push_back(FormatNanoseconds(results[row].mDevice));
+            table[row][1] = cells.back();
+            cells.push_back(FormatNanoseconds(results[row].mHost));
+            table[row][2] = cells.back();
+        }
+        *mOut << table;
+    }
+    *mOut << "Best local size: " << FormatSize(best->mLocal) << " at " << FormatNanoseconds(best->mDevice) << '\n';
+
+    if (!getLocalSizeCache().store(MakeKey(*mDriver, kernel, launch.mGlobal), best->mLocal))
+        *mErr << "The tuned local size could not be saved, and will only be used in this session.\n";
+}
@@ -0,0 +1,120 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+#include <unistd.h>
+
+#include "tuning.hpp"
+
+using namespace CLTestbench;
+
+namespace
+{
+bool IsPowerOfTwo(std::size_t value) { return value && (value & (value - 1)) == 0; }
+
+/// Each line of the file is the serialized key, followed by a tab and the local size.
+/// Tabs separate the key fields because device names often contain spaces.
+std::string Serialize(const LocalSizeCache::Key& key)
+{
+    std::ostringstream out;
+    out << key.mDevice << '\t' << key.mDriverVersion << '\t' << key.mKernel << '\t'
+        << key.mGlobal[0] << ' ' << key.mGlobal[1] << ' ' << key.mGlobal[2];
+    return out.str();
+}
+} // namespace
+
+std::vector<Driver::EnqueueSize> CLTestbench::LocalSizeCandidates(const Driver::EnqueueSize& global,
+                                                                  const Driver::KernelLimits& limits)
+{
+    std::vector<Driver::EnqueueSize> candidates;
+    if (limits.mMaxWorkGroupSize == 0 || global[0] == 0) return candidates;
+
+    const std::size_t multiple = limits.mPreferredMultiple ? limits.mPreferredMultiple : 1;
+    std::vector<std::size_t> dimensions[3];
+    for (unsigned dim = 0; dim < 3; ++dim) {
+        if (global[dim] == 0) {
+            dimensions[dim].push_back(0);
+            continue;
+        }
+        std::size_t max = std::min(global[dim], limits.mMaxWorkGroupSize);
+        if (limits.mMaxWorkItemSizes[dim]) max = std::min(max, limits.mMaxWorkItemSizes[dim]);
+        for (std::size_t size = 1; size <= max; ++size) {
+            if (global[dim] % size == 0 && (IsPowerOfTwo(size) || size % multiple == 0))
+                dimensions[dim].push_back(size);
+        }
+    }
+
+    for (std::size_t x : dimensions[0]) {
+        for (std::size_t y : dimensions[1]) {
+            for (std::size_t z : dimensions[2]) {
+                const std::size_t groupSize = x * (y ? y : 1) * (z ? z : 1);
+                if (groupSize <= limits.mMaxWorkGroupSize) candidates.push_back({x, y, z});
+            }
+        }
+    }
+    return candidates;
+}
+
+LocalSizeCache::LocalSizeCache(std::filesystem::path file) : mFile(std::move(file))
+{
+    std::ifstream in(mFile);
+    std::string line;
+    while (std::getline(in, line)) {
+        const std::size_t split = line.rfind('\t');
+        if (split == std::string::npos) continue;
+        std::istringstream local(line.substr(split + 1));
+        Driver::EnqueueSize size{};
+        if (local >> size[0] >> size[1] >> size[2]) mEntries[line.substr(0, split)] = size;
+    }
+}
+
+std::optional<Driver::EnqueueSize> LocalSizeCache::find(const Key& key) const
+{
+    auto it = mEntries.find(Serialize(key));
+    if (it == mEntries.end()) return std::nullopt;
+    return it->second;
+}
+
+bool LocalSizeCache::store(const Key& key, const Driver::EnqueueSize& local)
+{
+    mEntries[Serialize(key)] = local;
+    if (mFile.empty()) return false;
+
+    std::error_code error;
+    std::filesystem::create_directories(mFile.parent_path(), error);
+    // Write the whole cache aside and rename it over the old one, so that
+    // concurrent sessions never observe a partially written file.  Each process
+    // writes its own temporary file, so that they don't truncate each other's.
+    std::filesystem::path temporary = mFile;
+    temporary += "." + std::to_string(getpid()) + ".tmp";
+    bool written = false;
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        for (const auto& [entry, size] : mEntries)
+            out << entry << '\t' << size[0] << ' ' << size[1] << ' ' << size[2] << '\n';
+        written = static_cast<bool>(out.flush());
+    }
+    if (written) {
+        std::filesystem::rename(temporary, mFile, error);
+        written = !error;
+    }
+    if (!written) std::filesystem::remove(temporary, error);
+    return written;
+}
@@ -0,0 +1,61 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "driver.hpp"
+
+namespace CLTestbench
+{
+/// Lists the local sizes worth trying for a kernel launch of the given global size.
+/// Each local dimension divides the global one, and is either a power of two or a
+/// multiple of the kernel's preferred work-group size multiple.  Unused dimensions
+/// (where the global size is zero) are zero.
+std::vector<Driver::EnqueueSize> LocalSizeCandidates(const Driver::EnqueueSize& global,
+                                                     const Driver::KernelLimits& limits);
+
+/// Persistent store of the local sizes selected by the 'tune' command.
+/// Results are only valid for the same device, driver version, kernel and global size.
+class LocalSizeCache final
+{
+public:
+    struct Key
+    {
+        std::string mDevice;
+        std::string mDriverVersion;
+        std::string mKernel;
+        Driver::EnqueueSize mGlobal{};
+    };
+
+    /// Loads the cache file, if it exists.  Malformed lines are ignored.
+    explicit LocalSizeCache(std::filesystem::path file);
+
+    bool empty() const noexcept { return mEntries.empty(); }
+    std::optional<Driver::EnqueueSize> find(const Key&) const;
+    /// Records the local size and rewrites the cache file.
+    /// Returns false if the file could not be written; the entry is kept for this session.
+    bool store(const Key&, const Driver::EnqueueSize& local);
+
+private:
+    std::filesystem::path mFile;
+    /// Entries are keyed on their serialized Key.
+    std::map<std::string, Driver::EnqueueSize> mEntries;
+};
+} // namespace CLTestbench
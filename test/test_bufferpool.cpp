@@ -0,0 +1,110 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "bufferpool.hpp"
+
+namespace
+{
+std::vector<cl_mem> released;
+
+cl_int RecordRelease(cl_mem buffer)
+{
+    released.push_back(buffer);
+    return CL_SUCCESS;
+}
+
+cl_mem Handle(std::uintptr_t id) { return reinterpret_cast<cl_mem>(id); }
+} // namespace
+
+TEST_CASE("Buffer pool")
+{
+    using CLTestbench::BufferPool;
+    released.clear();
+
+    SECTION("Size classes")
+    {
+        CHECK(BufferPool::SizeClass(1) == 256);
+        CHECK(BufferPool::SizeClass(256) == 256);
+        CHECK(BufferPool::SizeClass(257) == 320);
+        CHECK(BufferPool::SizeClass(1000) == 1024);
+        CHECK(BufferPool::SizeClass(1024) == 1024);
+        CHECK(BufferPool::SizeClass(1025) == 1280);
+        CHECK(BufferPool::SizeClass(3 << 20) == 3 << 20);
+    }
+
+    SECTION("Reuse")
+    {
+        auto pool = std::make_shared<BufferPool>(RecordRelease);
+        pool->setLimit(4096);
+        CHECK(!pool->acquire(1024, CL_MEM_READ_WRITE));
+        { auto lease = pool->adopt(Handle(1), 1024, CL_MEM_READ_WRITE); }
+        CHECK(released.empty());
+        CHECK(pool->getIdleBytes() == 1024);
+
+        // Different flags or sizes miss.
+        CHECK(!pool->acquire(1024, CL_MEM_READ_ONLY));
+        CHECK(!pool->acquire(2048, CL_MEM_READ_WRITE));
+        auto lease = pool->acquire(1024, CL_MEM_READ_WRITE);
+        REQUIRE(lease);
+        CHECK(lease.get() == Handle(1));
+        CHECK(pool->getIdleCount() == 0);
+        const auto stats = pool->getStats();
+        CHECK(stats.mHits == 1);
+        CHECK(stats.mMisses == 3);
+    }
+
+    SECTION("Limit")
+    {
+        auto pool = std::make_shared<BufferPool>(RecordRelease);
+        pool->setLimit(2048);
+        {
+            auto first = pool->adopt(Handle(1), 1024, 0);
+            auto second = pool->adopt(Handle(2), 1024, 0);
+            auto third = pool->adopt(Handle(3), 1024, 0);
+            auto large = pool->adopt(Handle(4), 4096, 0);
+        }
+        // The large buffer never fits; then the least recently returned is evicted.
+        REQUIRE(released.size() == 2);
+        CHECK(released[0] == Handle(4));
+        CHECK(pool->getIdleBytes() == 2048);
+        CHECK(pool->getStats().mEvictions == 1);
+
+        pool->setLimit(0);
+        CHECK(released.size() == 4);
+        CHECK(!pool->isEnabled());
+    }
+
+    SECTION("Drain")
+    {
+        auto pool = std::make_shared<BufferPool>(RecordRelease);
+        pool->setLimit(4096);
+        auto lease = pool->adopt(Handle(1), 1024, 0);
+        pool->drain();
+        // Leased before the drain, so it may belong to another context.
+        lease = {};
+        CHECK(released.size() == 1);
+        CHECK(pool->getIdleCount() == 0);
+
+        // Leases outliving their pool release their buffer.
+        lease = pool->adopt(Handle(2), 1024, 0);
+        pool.reset();
+        lease = {};
+        CHECK(released.size() == 2);
+    }
+}
@@ -0,0 +1,45 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <catch2/catch_test_macros.hpp>
+#include <sstream>
+
+#include "chrometrace.hpp"
+
+TEST_CASE("Chrome trace")
+{
+    SECTION("Events and tracks")
+    {
+        std::vector<CLTestbench::TraceEvent> events(2);
+        events[0].mName = "run \"k\"";
+        events[0].mCategory = "command";
+        events[0].mStart = 1500;
+        events[0].mDuration = 250000;
+        events[1].mName = "write buffer";
+        events[1].mCategory = "device";
+        events[1].mTrack = 1;
+        events[1].mStart = 2000000;
+        events[1].mDuration = 7;
+
+        std::ostringstream out;
+        CLTestbench::WriteChromeTrace(out, events, {"Testbench commands", "Queue 0"});
+        const std::string trace = out.str();
+        CHECK(trace.find("\"traceEvents\": [") != std::string::npos);
+        CHECK(trace.find("\"args\": {\"name\": \"Queue 0\"}") != std::string::npos);
+        CHECK(trace.find("\"name\": \"run \\\"k\\\"\"") != std::string::npos);
+        CHECK(trace.find("\"ts\": 1.500, \"dur\": 250.000") != std::string::npos);
+        CHECK(trace.find("\"tid\": 1, \"ts\": 2000.000, \"dur\": 0.007") != std::string::npos);
+    }
+}
@@ -0,0 +1,65 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstdlib>
+
+#include "clocksync.hpp"
+
+TEST_CASE("Clock synchronisation")
+{
+    SECTION("Single sample")
+    {
+        CLTestbench::ClockSync sync;
+        CHECK(sync.empty());
+        sync.addSample({5000, 1000});
+        CHECK(sync.toHost(1000) == 5000);
+        CHECK(sync.toHost(3000) == 7000);
+        CHECK(sync.driftPPM() == 0.0);
+    }
+
+    SECTION("Drift")
+    {
+        // The device clock runs 100 ppm slow, starting 1s behind the host.
+        CLTestbench::ClockSync sync;
+        for (int64_t second = 1; second <= 10; ++second) {
+            const int64_t host = second * 1000000000;
+            sync.addSample({host, static_cast<uint64_t>((host - 1000000000) * 0.9999)});
+        }
+        CHECK(sync.driftPPM() > 99.0);
+        CHECK(sync.driftPPM() < 101.0);
+        // Half way between samples, and past the last one.
+        const int64_t host = 5500000000;
+        CHECK(std::abs(sync.toHost(static_cast<uint64_t>((host - 1000000000) * 0.9999)) - host) < 10);
+        const int64_t later = 20000000000;
+        CHECK(std::abs(sync.toHost(static_cast<uint64_t>((later - 1000000000) * 0.9999)) - later) < 10);
+    }
+
+    SECTION("Sample limit")
+    {
+        CLTestbench::ClockSync sync;
+        for (uint64_t i = 0; i < CLTestbench::ClockSync::MaxSamples * 2; ++i)
+            sync.addSample({static_cast<int64_t>(i * 10000000), i * 10000000});
+        CHECK(sync.size() == CLTestbench::ClockSync::MaxSamples);
+        CHECK(sync.toHost(12345) == 12345);
+    }
+
+    SECTION("Enqueue offset estimate")
+    {
+        CHECK(CLTestbench::EstimateDeviceToHostOffset({}) == 0);
+        // The device clock runs 1000ns behind; the enqueue overhead varies.
+        CHECK(CLTestbench::EstimateDeviceToHostOffset({{1500, 400}, {2100, 1100}, {5000, 3950}}) == 1000);
+    }
+}
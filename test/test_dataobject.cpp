@@ -15,6 +15,11 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "cltb_config.h"
 #include "object_data.hpp"
 #include "testbench.hpp"
 #include "token.hpp"
@@ -244,3 +249,37 @@ TEST_CASE("Parse float data objects")
         CHECK(numbers[5] == 0.00006103515625);
     }
 }
+
+TEST_CASE("File data objects")
+{
+    std::ifstream file(PROJECT_SOURCE_DIR "/test/pngtest8rgba.png", std::ios::binary);
+    const std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    REQUIRE(contents.size() > 5000);
+
+    SECTION("Range")
+    {
+        // The range starts past the first page, and not on a page boundary.
+        CLTestbench::TokenStream tokens("file(" PROJECT_SOURCE_DIR "/test/pngtest8rgba.png, 4999, 100)");
+        CLTestbench::Testbench bench;
+
+        auto object = bench.evaluate(tokens);
+        const auto* data = dynamic_cast<CLTestbench::DataObject*>(object.get());
+        REQUIRE(data);
+        REQUIRE(data->size() == 100);
+        const auto* bytes = static_cast<const char*>(data->data());
+        CHECK(std::vector<char>(bytes, bytes + 100) == std::vector<char>(&contents[4999], &contents[5099]));
+    }
+
+    SECTION("Clamped length")
+    {
+        CLTestbench::TokenStream tokens("file(" PROJECT_SOURCE_DIR "/test/pngtest8rgba.png, 10, 1000000)");
+        CLTestbench::Testbench bench;
+
+        auto object = bench.evaluate(tokens);
+        const auto* data = dynamic_cast<CLTestbench::DataObject*>(object.get());
+        REQUIRE(data);
+        REQUIRE(data->size() == contents.size() - 10);
+        const auto* bytes = static_cast<const char*>(data->data());
+        CHECK(std::vector<char>(bytes, bytes + data->size()) == std::vector<char>(contents.begin() + 10, contents.end()));
+    }
+}
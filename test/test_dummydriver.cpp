@@ -15,7 +15,12 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <sstream>
+#include <vector>
 
 #include "cltb_config.h"
 #include "testbench.hpp"
@@ -46,3 +51,486 @@ TEST_CASE("Dummy driver")
         CHECK_NOTHROW(bench.run(tokens) == CLTestbench::Testbench::Result::Quit);
     }
 }
+
+TEST_CASE("Dummy driver commands")
+{
+    CLTestbench::Testbench bench;
+    std::ostringstream out;
+    VoidStream err;
+    bench.resetOutput(out);
+    bench.resetErrorOutput(err);
+    using Result = CLTestbench::Testbench::Result;
+    REQUIRE(bench.run("load " CMAKE_BINARY_DIR "/test/libdummycl.so") == Result::Good);
+    out.str("");
+
+    SECTION("profiling")
+    {
+        CHECK(bench.run("stats") == Result::Good);
+        CHECK(out.str() == "No profiled commands.  Use 'set profile on' to enable profiling.\n");
+        CHECK(bench.run("set profile on") == Result::Good);
+        CHECK(bench.run("buf = buffer(int(1, 2, 3))") == Result::Good);
+        CHECK(bench.run("k = kernel(program(char(32)), k)") == Result::Good);
+        CHECK(bench.run("run k((16),, buf)") == Result::Good);
+        // Runs whose event is kept are recorded too.
+        CHECK(bench.run("e = run k((16),, buf)") == Result::Good);
+        out.str("");
+        CHECK(bench.run("stats") == Result::Good);
+        // The dummy driver runs every command from 3 us to 5 us, after queueing it at 1 us.
+        CHECK(out.str().find("  # | Command | Start    | Queued   | Submitted | Duration\n") != std::string::npos);
+        CHECK(out.str().find("  0 | run k   | 0.000 us | 1.000 us | 1.000 us  | 2.000 us\n") != std::string::npos);
+        CHECK(out.str().find("  1 | run k   | 0.000 us | 1.000 us | 1.000 us  | 2.000 us\n") != std::string::npos);
+        CHECK(out.str().find("  2 |") == std::string::npos);
+        CHECK(out.str().find("Total device time: 4.000 us\n") != std::string::npos);
+        CHECK(out.str().find("  copy     | 12                | 0\n") != std::string::npos);
+        CHECK(bench.run("stats clear") == Result::Good);
+        out.str("");
+        CHECK(bench.run("stats") == Result::Good);
+        CHECK(out.str().find("No profiled commands.\n") != std::string::npos);
+        CHECK(bench.run("set profile off") == Result::Good);
+        CHECK(bench.run("stats bogus") == Result::Fail);
+    }
+
+    SECTION("bench command")
+    {
+        REQUIRE(bench.run("k = kernel(program(char(32)), k)") == Result::Good);
+        CHECK(bench.run("bench k((16),) 5 1") == Result::Good);
+        CHECK(out.str().find("5 iterations after 1 warmup runs:\n") != std::string::npos);
+        CHECK(out.str().find("         | Min      | Median   | Mean     | P95      | P99      | StdDev\n") !=
+              std::string::npos);
+        // Every launch of the dummy driver takes 2 us on the device.
+        CHECK(out.str().find("  Device | 2.000 us | 2.000 us | 2.000 us | 2.000 us | 2.000 us | 0.000 us\n") !=
+              std::string::npos);
+        CHECK(out.str().find("  Host   | ") != std::string::npos);
+        out.str("");
+        // The timed launches aren't recorded.
+        CHECK(bench.run("stats") == Result::Good);
+        CHECK(out.str().find("No profiled commands.") != std::string::npos);
+        CHECK(bench.run("bench k((16),) 0") == Result::Fail);
+    }
+
+    SECTION("program cache option")
+    {
+        CHECK(bench.run("set programcache off") == Result::Good);
+        CHECK(bench.run("p = program(char(32))") == Result::Good);
+        CHECK(bench.run("set programcache on") == Result::Good);
+        CHECK(bench.run("q = program(char(32))") == Result::Good);
+        CHECK(bench.run("set") == Result::Good);
+        // The dummy driver has no binaries, so nothing is stored, but the lookup still missed.
+        CHECK(out.str().find("programcache: yes (0 hits, 1 misses)") != std::string::npos);
+        CHECK(bench.run("set programcache maybe") == Result::Fail);
+    }
+
+    SECTION("asynchronous builds")
+    {
+        CHECK(bench.run("set asyncbuild on") == Result::Good);
+        CHECK(bench.run("p = program(char(32))") == Result::Good);
+        CHECK(bench.run("q = program(char(32))") == Result::Good);
+        CHECK(bench.run("k = kernel(p, k)") == Result::Good);
+        // Programs still building are released safely.
+        CHECK(bench.run("release q") == Result::Good);
+        CHECK(bench.run("r = program(char(32))") == Result::Good);
+    }
+
+    SECTION("buffer flags")
+    {
+        CHECK(bench.run("a = buffer(64, use_host)") == Result::Good);
+        CHECK(bench.run("save a " CMAKE_BINARY_DIR "/test/use_host.bin") == Result::Good);
+        CHECK(bench.run("b = buffer(int(1, 2, 3), use_host, read_only)") == Result::Good);
+        CHECK(bench.run("c = buffer(int(1, 2, 3), 4, alloc_host)") == Result::Good);
+        CHECK(bench.run("d = buffer(int(1, 2, 3), 4, 4, write_only)") == Result::Good);
+        CHECK(bench.run("e = buffer(16, host_no_access)") == Result::Good);
+        CHECK(bench.run("save e " CMAKE_BINARY_DIR "/test/host_no_access.bin") == Result::Fail);
+        CHECK(bench.run("f = buffer(16, read_only, write_only)") == Result::Fail);
+        CHECK(bench.run("f = buffer(16, use_host, alloc_host)") == Result::Fail);
+        CHECK(bench.run("f = buffer(16, executable)") == Result::Fail);
+    }
+
+    SECTION("mapped transfers")
+    {
+        const auto filename = std::filesystem::temp_directory_path() / "cltb_mapped.bin";
+        auto readFile = [&] {
+            std::ifstream file(filename, std::ios::binary);
+            std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            std::vector<int> values(data.size() / sizeof(int));
+            std::memcpy(values.data(), data.data(), values.size() * sizeof(int));
+            return values;
+        };
+
+        // The dummy device reports unified memory, so nothing is printed about it.
+        CHECK(bench.run("set transfer map") == Result::Good);
+        CHECK(out.str().empty());
+        CHECK(bench.run("b = buffer(int(1, 2, 3))") == Result::Good);
+        CHECK(bench.run("save b " + filename.string()) == Result::Good);
+        CHECK(readFile() == std::vector<int>{1, 2, 3});
+        CHECK(bench.run("set transfer copy") == Result::Good);
+        CHECK(bench.run("c = buffer(int(4, 5))") == Result::Good);
+        CHECK(bench.run("save c " + filename.string()) == Result::Good);
+        CHECK(readFile() == std::vector<int>{4, 5});
+        std::filesystem::remove(filename);
+        CHECK(bench.run("stats") == Result::Good);
+        // 12 bytes were mapped each way, and 8 copied each way.
+        CHECK(out.str().find("  copy     | 8                 | 8\n") != std::string::npos);
+        CHECK(out.str().find("  map      | 12                | 12\n") != std::string::npos);
+        CHECK(bench.run("set transfer sideways") == Result::Fail);
+    }
+
+    SECTION("fill")
+    {
+        CHECK(bench.run("b = buffer(1024, float(0))") == Result::Good);
+        CHECK(bench.run("c = buffer(1024, uint(0xdeadbeef), read_only)") == Result::Good);
+        CHECK(bench.run("fill b float(1)") == Result::Good);
+        CHECK(bench.run("fill b ushort(1) 2 6") == Result::Good);
+        CHECK(bench.run("fill b float(1) 512") == Result::Good);
+        // Pattern sizes must be powers of two, and divide the region.
+        CHECK(bench.run("fill b char(1, 2, 3)") == Result::Fail);
+        CHECK(bench.run("fill b float(1) 2") == Result::Fail);
+        CHECK(bench.run("fill b float(1) 0 2048") == Result::Fail);
+        CHECK(bench.run("d = buffer(6, int(1))") == Result::Fail);
+    }
+
+    SECTION("slices")
+    {
+        CHECK(bench.run("b = buffer(1024)") == Result::Good);
+        CHECK(bench.run("s = slice(b, 256, 512)") == Result::Good);
+        CHECK(bench.run("t = slice(s, 128)") == Result::Good);
+        // The slice keeps the buffer alive.
+        CHECK(bench.run("release b") == Result::Good);
+        CHECK(bench.run("fill t int(0)") == Result::Good);
+        CHECK(bench.run("u = slice(s, 0, 1024)") == Result::Fail);
+        CHECK(bench.run("u = slice(s, 512)") == Result::Fail);
+        CHECK(bench.run("u = slice(int(1), 0)") == Result::Fail);
+    }
+
+    SECTION("svm")
+    {
+        CHECK(bench.run("c = svm(256)") == Result::Good);
+        CHECK(bench.run("f = svm(int(1, 2, 3, 4), fine)") == Result::Good);
+        CHECK(bench.run("g = clone(f)") == Result::Good);
+        CHECK(bench.run("k = kernel(program(char(32)), k)") == Result::Good);
+        CHECK(bench.run("run k((16), (4), c, f)") == Result::Good);
+        CHECK(bench.run("bind k 0 g") == Result::Good);
+        // The dummy driver doesn't support SVM atomics.
+        CHECK(bench.run("a = svm(64, fine, atomics)") == Result::Fail);
+        CHECK(bench.run("a = svm(64, atomics)") == Result::Fail);
+        CHECK(bench.run("a = svm(64, shared)") == Result::Fail);
+        CHECK(bench.run("a = svm(0)") == Result::Fail);
+
+        const auto filename = std::filesystem::temp_directory_path() / "cltb_svm_test.bin";
+        CHECK(bench.run("save f " + filename.string()) == Result::Good);
+        std::ifstream file(filename, std::ios::binary);
+        std::vector<char> saved((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        REQUIRE(saved.size() == 4 * sizeof(int));
+        CHECK(reinterpret_cast<const int*>(saved.data())[3] == 4);
+        file.close();
+        std::filesystem::remove(filename);
+        CHECK(bench.run("save c " + filename.string()) == Result::Good);
+        CHECK(std::filesystem::file_size(filename) == 256);
+        std::filesystem::remove(filename);
+    }
+
+    SECTION("queues")
+    {
+        CHECK(bench.run("q1 = queue(out_of_order, profiling)") == Result::Good);
+        CHECK(bench.run("q2 = queue()") == Result::Good);
+        CHECK(bench.run("q3 = queue(sideways)") == Result::Fail);
+        CHECK(bench.run("b = buffer(64)") == Result::Good);
+        CHECK(bench.run("k = kernel(program(char(32)), k)") == Result::Good);
+        CHECK(bench.run("e1 = run k((16),, b) on q1") == Result::Good);
+        CHECK(bench.run("e2 = run k((16),) on q2 after e1") == Result::Good);
+        CHECK(bench.run("run k((16),) after e1, e2 on q1") == Result::Good);
+        CHECK(bench.run("run k((16),) after e1 e2") == Result::Good);
+        CHECK(bench.run("run k((16),) on b") == Result::Fail);
+        CHECK(bench.run("run k((16),) after q1") == Result::Fail);
+        CHECK(bench.run("run k((16),) before e1") == Result::Fail);
+        CHECK(bench.run("run k((16), (4), (32), b)") == Result::Good);
+        CHECK(bench.run("run k((16),, (32 0), b) on q1") == Result::Good);
+        CHECK(bench.run("run k((16),, (32)") == Result::Fail);
+        CHECK(bench.run("wait e1 e2") == Result::Good);
+        CHECK(bench.run("wait q1, q2") == Result::Good);
+        CHECK(bench.run("wait b") == Result::Fail);
+        CHECK(bench.run("flush q2") == Result::Good);
+        CHECK(bench.run("flush") == Result::Good);
+        CHECK(bench.run("wait") == Result::Good);
+        CHECK(bench.run("list") == Result::Good);
+        CHECK(out.str().find("CL event") != std::string::npos);
+        CHECK(out.str().find("CL command queue") != std::string::npos);
+    }
+
+    SECTION("profiling queue")
+    {
+        // The default queue isn't profiling, but launches on a profiling queue are recorded.
+        CHECK(bench.run("b = buffer(64)") == Result::Good);
+        CHECK(bench.run("k = kernel(program(char(32)), k)") == Result::Good);
+        CHECK(bench.run("q = queue(profiling)") == Result::Good);
+        CHECK(bench.run("run k((4),, b, 4, 16) on q") == Result::Good);
+        out.str("");
+        CHECK(bench.run("stats") == Result::Good);
+        CHECK(out.str().find("  0 | run k   | 0.000 us | 1.000 us | 1.000 us  | 2.000 us\n") != std::string::npos);
+        CHECK(out.str().find("  1 |") == std::string::npos);
+    }
+
+    SECTION("multiple devices")
+    {
+        CHECK(bench.run("select devices 0 0") == Result::Fail);
+        CHECK(bench.run("select devices 0 2") == Result::Fail);
+        CHECK(bench.run("select devices all") == Result::Good);
+        CHECK(bench.run("b = buffer(64)") == Result::Good);
+        CHECK(bench.run("k = kernel(program(char(32)), k)") == Result::Good);
+        CHECK(bench.run("run k((1024), (64), b) split") == Result::Good);
+        CHECK(bench.run("run k((1024),) split 3 1") == Result::Good);
+        CHECK(bench.run("run k((1024),,(4096)) split 1 1") == Result::Good);
+        CHECK(bench.run("run k((1024),) split 3") == Result::Fail);
+        CHECK(bench.run("e = run k((1024),) split") == Result::Fail);
+        CHECK(bench.run("migrate b to 1") == Result::Good);
+        CHECK(bench.run("migrate b to host") == Result::Good);
+        CHECK(bench.run("migrate b to 2") == Result::Fail);
+        CHECK(bench.run("migrate k to 0") == Result::Fail);
+        CHECK(bench.run("wait") == Result::Good);
+        CHECK(bench.run("set profile on") == Result::Good);
+        CHECK(bench.run("run k((1024),) split 1 1") == Result::Good);
+        CHECK(bench.run("stats") == Result::Good);
+        // Selecting one device again clears the objects of the shared context.
+        CHECK(bench.run("select device 1") == Result::Good);
+        CHECK(bench.run("run k((1024),) split") == Result::Fail);
+    }
+
+    SECTION("trace")
+    {
+        const auto filename = std::filesystem::temp_directory_path() / "cltb_trace.json";
+        CHECK(bench.run("trace stop") == Result::Fail);
+        CHECK(bench.run("trace start " + filename.string()) == Result::Good);
+        CHECK(bench.run("trace start " + filename.string()) == Result::Fail);
+        CHECK(bench.run("b = buffer(64)") == Result::Good);
+        CHECK(bench.run("k = kernel(program(char(32)), k)") == Result::Good);
+        CHECK(bench.run("run k((16),, b)") == Result::Good);
+        CHECK(bench.run("trace stop") == Result::Good);
+
+        std::ifstream file(filename);
+        std::string trace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        CHECK(trace.find("\"traceEvents\"") != std::string::npos);
+        CHECK(trace.find("\"name\": \"run k((16),, b)\"") != std::string::npos);
+        CHECK(trace.find("trace stop") == std::string::npos);
+        file.close();
+        std::filesystem::remove(filename);
+    }
+
+    SECTION("device capabilities")
+    {
+        CHECK(bench.run("info devices") == Result::Good);
+        CHECK(out.str().find("Compute units: 8") != std::string::npos);
+        CHECK(out.str().find("Host unified memory: yes") != std::string::npos);
+        // The dummy driver doesn't know the half width, which is left zero.
+        CHECK(out.str().find(", half 0\n") != std::string::npos);
+        CHECK(bench.run("b = buffer(64)") == Result::Good);
+        out.str("");
+        CHECK(bench.run("info devices json") == Result::Good);
+        CHECK(out.str().find("\"compute_units\": 8") != std::string::npos);
+        CHECK(out.str().find("\"selected\": true") != std::string::npos);
+        CHECK(out.str().find("\"selected\": false") != std::string::npos);
+        CHECK(bench.run("info devices xml") == Result::Fail);
+    }
+
+    SECTION("kernel argument info")
+    {
+        CHECK(bench.run("b = buffer(64)") == Result::Good);
+        CHECK(bench.run("k = kernel(program(char(32)), k)") == Result::Good);
+        // The dummy kernel takes (__global float* a, uint n, __local float* tmp).
+        CHECK(bench.run("run k((16),, b, 42, 256)") == Result::Good);
+        CHECK(bench.run("bind k 1 3.5") == Result::Fail);
+        CHECK(bench.run("bind k 1 7") == Result::Good);
+        CHECK(bench.run("bind k 0 7") == Result::Fail);
+        CHECK(bench.run("bind k 3 7") == Result::Fail);
+        CHECK(bench.run("info kernel k") == Result::Good);
+        CHECK(out.str().find("uint") != std::string::npos);
+        CHECK(out.str().find("local") != std::string::npos);
+    }
+
+    SECTION("rebinds and rerun")
+    {
+        CHECK(bench.run("rerun") == Result::Fail);
+        CHECK(bench.run("b = buffer(64)") == Result::Good);
+        CHECK(bench.run("k = kernel(program(char(32)), k)") == Result::Good);
+        CHECK(bench.run("k2 = kernel(program(char(32)), k)") == Result::Good);
+        CHECK(bench.run("rerun k") == Result::Fail);
+        CHECK(bench.run("run k((16),, b, 42, 256)") == Result::Good);
+        CHECK(bench.run("run k((16),, b, 42, 512)") == Result::Good);
+        CHECK(bench.run("run k2((16),, b)") == Result::Good);
+        CHECK(bench.run("rerun") == Result::Good);
+        CHECK(bench.run("rerun k 10") == Result::Good);
+        CHECK(bench.run("rerun k2") == Result::Good);
+        CHECK(bench.run("rerun b") == Result::Fail);
+        CHECK(bench.run("info kernel k") == Result::Good);
+        // Only the local size changed on the second run.
+        CHECK(out.str().find("4 set, 2 skipped") != std::string::npos);
+
+        // Bound buffers are freed when released, and the kernels can't run until they're rebound.
+        CHECK(bench.run("release b") == Result::Good);
+        out.str("");
+        CHECK(bench.run("info memory") == Result::Good);
+        CHECK(out.str().find("Live: 0 bytes in 0 memory objects") != std::string::npos);
+        CHECK(bench.run("rerun k") == Result::Fail);
+        CHECK(bench.run("run k2((16),)") == Result::Fail);
+        CHECK(bench.run("b = buffer(64)") == Result::Good);
+        CHECK(bench.run("run k2((16),, b)") == Result::Good);
+        CHECK(bench.run("rerun k2 1 extra") == Result::Good);
+        out.str("");
+        CHECK(bench.run("info kernel k2") == Result::Good);
+        CHECK(out.str().find("2 set, 0 skipped") != std::string::npos);
+
+        // Remembered launches don't keep their kernel, queue or events alive either.
+        CHECK(bench.run("q = queue()") == Result::Good);
+        CHECK(bench.run("e = run k2((16),) on q") == Result::Good);
+        CHECK(bench.run("run k2((16),) on q after e") == Result::Good);
+        CHECK(bench.run("release e") == Result::Good);
+        CHECK(bench.run("rerun k2") == Result::Fail);
+        CHECK(bench.run("run k2((16),) on q") == Result::Good);
+        CHECK(bench.run("rerun k2") == Result::Good);
+        CHECK(bench.run("release q") == Result::Good);
+        CHECK(bench.run("rerun k2") == Result::Fail);
+        CHECK(bench.run("release k2") == Result::Good);
+        CHECK(bench.run("rerun") == Result::Fail);
+    }
+
+    SECTION("memory ledger")
+    {
+        CHECK(bench.run("a = buffer(200000)") == Result::Good);
+        CHECK(bench.run("b = buffer(200000, read_only)") == Result::Good);
+        CHECK(bench.run("c = clone(b)") == Result::Good);
+        // Over CL_DEVICE_MAX_MEM_ALLOC_SIZE.
+        CHECK(bench.run("d = buffer(300000)") == Result::Fail);
+        CHECK(bench.run("d = buffer(200000)") == Result::Good);
+        CHECK(bench.run("e = buffer(200000)") == Result::Good);
+        // Over CL_DEVICE_GLOBAL_MEM_SIZE, with the other buffers.
+        CHECK(bench.run("f = buffer(200000)") == Result::Fail);
+        CHECK(bench.run("release c") == Result::Good);
+        CHECK(bench.run("f = buffer(200000)") == Result::Good);
+        CHECK(bench.run("release a") == Result::Good);
+        out.str("");
+        CHECK(bench.run("info memory") == Result::Good);
+        CHECK(out.str().find("Live: 800000 bytes in 4 memory objects") != std::string::npos);
+        CHECK(out.str().find("High watermark: 1000000 bytes.") != std::string::npos);
+        CHECK(out.str().find("read_only") != std::string::npos);
+    }
+
+    SECTION("buffer pool")
+    {
+        CHECK(bench.run("set bufferpool 4096") == Result::Good);
+        CHECK(bench.run("a = buffer(1000)") == Result::Good);
+        CHECK(bench.run("release a") == Result::Good);
+        CHECK(bench.run("a = buffer(1024)") == Result::Good);
+        CHECK(bench.run("b = buffer(1024, read_only)") == Result::Good);
+        out.str("");
+        CHECK(bench.run("info memory") == Result::Good);
+        // Both sizes are in the same class, so the first buffer is reused.
+        CHECK(out.str().find("Live: 2048 bytes") != std::string::npos);
+        CHECK(out.str().find("1 hits, 2 misses") != std::string::npos);
+        CHECK(bench.run("set bufferpool off") == Result::Good);
+        CHECK(bench.run("set bufferpool on") == Result::Good);
+    }
+
+    SECTION("lazy upload")
+    {
+        CHECK(bench.run("set lazyupload on") == Result::Good);
+        CHECK(bench.run("a = buffer(float(1, 2, 3, 4))") == Result::Good);
+        CHECK(bench.run("b = clone(a)") == Result::Good);
+        CHECK(bench.run("c = buffer(float(1, 2, 3, 4))") == Result::Good);
+        CHECK(bench.run("fill c float(0)") == Result::Good);
+        out.str("");
+        CHECK(bench.run("stats") == Result::Good);
+        // Nothing is uploaded until used, and the fill replaced the data of c.
+        CHECK(out.str().find("copy") == std::string::npos);
+        CHECK(bench.run("k = kernel(program(char(32)), k)") == Result::Good);
+        CHECK(bench.run("run k((4),, a, 4, 16)") == Result::Good);
+        CHECK(bench.run("run k((4),, a, 4, 16)") == Result::Good);
+        out.str("");
+        CHECK(bench.run("stats") == Result::Good);
+        CHECK(out.str().find("| 16 ") != std::string::npos);
+    }
+
+    SECTION("streamed upload")
+    {
+        CHECK(bench.run("set streamchunk on") == Result::Fail);
+        CHECK(bench.run("set streamchunk 4096") == Result::Good);
+        // Three chunks, through both staging buffers.
+        CHECK(bench.run("a = buffer(file(" PROJECT_SOURCE_DIR "/test/pngtest8rgba.png, 0))") == Result::Good);
+        CHECK(bench.run("set streamchunk off") == Result::Good);
+        CHECK(bench.run("b = buffer(file(" PROJECT_SOURCE_DIR "/test/pngtest8rgba.png, 0))") == Result::Good);
+        out.str("");
+        CHECK(bench.run("stats") == Result::Good);
+        CHECK(out.str().find("Streamed uploads: 8574 bytes in ") != std::string::npos);
+        CHECK(out.str().find("| 17148 ") != std::string::npos);
+
+        // Three chunks are read back, through all the staging buffers, and written by the writer thread.
+        const auto filename = std::filesystem::temp_directory_path() / "cltb_streamed.bin";
+        CHECK(bench.run("set streamchunk 4096") == Result::Good);
+        CHECK(bench.run("save a " + filename.string()) == Result::Good);
+        CHECK(std::filesystem::file_size(filename) == 8574);
+        std::filesystem::remove(filename);
+        out.str("");
+        CHECK(bench.run("stats") == Result::Good);
+        CHECK(out.str().find("Streamed readbacks: 8574 bytes in ") != std::string::npos);
+        // Write errors fail the command.
+        if (std::filesystem::exists("/dev/full")) CHECK(bench.run("save a /dev/full") == Result::Fail);
+    }
+
+    SECTION("background save")
+    {
+        CHECK(bench.run("jobs") == Result::Good);
+        CHECK(out.str() == "No save jobs.\n");
+        CHECK(bench.run("set asyncsave on") == Result::Good);
+        CHECK(bench.run("a = buffer(float(1, 2, 3, 4))") == Result::Good);
+        const auto filename = std::filesystem::temp_directory_path() / "cltb_background.bin";
+        out.str("");
+        CHECK(bench.run("save a " + filename.string()) == Result::Good);
+        CHECK(out.str() == "Started save job 1.\n");
+        // The job keeps the buffer alive.
+        CHECK(bench.run("release a") == Result::Good);
+        CHECK(bench.run("save a " + filename.string()) == Result::Fail);
+        CHECK(bench.run("wait jobs") == Result::Good);
+        CHECK(std::filesystem::file_size(filename) == 16);
+        std::filesystem::remove(filename);
+        out.str("");
+        CHECK(bench.run("jobs") == Result::Good);
+        CHECK(out.str() == "No save jobs.\n");
+
+        CHECK(bench.run("b = buffer(float(1, 2))") == Result::Good);
+        CHECK(bench.run("save b " + filename.string()) == Result::Good);
+        CHECK(bench.run("wait") == Result::Good);
+        out.str("");
+        // Once done, a job is listed by 'jobs' one last time.
+        while (out.str().find("writing") != std::string::npos || out.str().empty()) {
+            out.str("");
+            CHECK(bench.run("jobs") == Result::Good);
+        }
+        CHECK(out.str().find("| done") != std::string::npos);
+        CHECK(std::filesystem::file_size(filename) == 8);
+        std::filesystem::remove(filename);
+        out.str("");
+        CHECK(bench.run("jobs") == Result::Good);
+        CHECK(out.str() == "No save jobs.\n");
+        CHECK(bench.run("save b /nonexistent/cltb_background.bin") == Result::Fail);
+
+        // Three chunks are read and written by the job.
+        CHECK(bench.run("set streamchunk 4096") == Result::Good);
+        CHECK(bench.run("c = buffer(file(" PROJECT_SOURCE_DIR "/test/pngtest8rgba.png, 0))") == Result::Good);
+        CHECK(bench.run("save c " + filename.string()) == Result::Good);
+        CHECK(bench.run("wait jobs") == Result::Good);
+        {
+            std::ifstream saved(filename, std::ios::binary), source(PROJECT_SOURCE_DIR "/test/pngtest8rgba.png",
+                                                                      std::ios::binary);
+            const std::string savedData{std::istreambuf_iterator<char>(saved), {}};
+            const std::string sourceData{std::istreambuf_iterator<char>(source), {}};
+            CHECK(savedData.size() == 8574);
+            CHECK(savedData == sourceData);
+        }
+        std::filesystem::remove(filename);
+
+        // Other objects are saved at once.
+        CHECK(bench.run("d = int(1, 2)") == Result::Good);
+        out.str("");
+        CHECK(bench.run("save d " + filename.string()) == Result::Good);
+        CHECK(out.str() == "This object is saved at once, not in the background.\n");
+        CHECK(std::filesystem::file_size(filename) == 8);
+        std::filesystem::remove(filename);
+    }
+}
@@ -0,0 +1,72 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+
+#include "programcache.hpp"
+
+using namespace CLTestbench;
+
+TEST_CASE("Program binary cache")
+{
+    SECTION("Keys")
+    {
+        const std::string key = ProgramCache::MakeKey("kernel void k() {}", "-O2", "Platform", "Device", "1.0");
+        CHECK(key == ProgramCache::MakeKey("kernel void k() {}", "-O2", "Platform", "Device", "1.0"));
+        CHECK(key != ProgramCache::MakeKey("kernel void k() {}", "", "Platform", "Device", "1.0"));
+        CHECK(key != ProgramCache::MakeKey("kernel void k() {}", "-O2", "Platform", "Device", "1.1"));
+        CHECK(key != ProgramCache::MakeKey("kernel void k() {}", "-O2", "Platform", "Other", "1.0"));
+        // Moving text between fields must change the key.
+        CHECK(ProgramCache::MakeKey("ab", "c", "", "", "") != ProgramCache::MakeKey("a", "bc", "", "", ""));
+    }
+
+    SECTION("Storage")
+    {
+        const auto directory = std::filesystem::temp_directory_path() / "cltb_test_programs";
+        std::filesystem::remove_all(directory);
+
+        ProgramCache cache(directory);
+        const std::string key = ProgramCache::MakeKey("source", "", "Platform", "Device", "1.0");
+        CHECK(!cache.load(key));
+        // Empty binaries are never stored.
+        CHECK(!cache.store(key, {}));
+        CHECK(cache.store(key, {'\x7f', 'E', 'L', 'F'}));
+
+        auto binary = cache.load(key);
+        REQUIRE(binary);
+        CHECK(*binary == std::vector<char>{'\x7f', 'E', 'L', 'F'});
+
+        cache.discard(key);
+        CHECK(!cache.load(key));
+
+        CHECK(cache.store(key, {'1'}));
+        CHECK(cache.store(ProgramCache::MakeKey("other", "", "Platform", "Device", "1.0"), {'2'}));
+        CHECK(cache.clear() == 2);
+        CHECK(!cache.load(key));
+
+        // A binary stored for another key isn't loaded, even from the file of this key.
+        const std::string other = ProgramCache::MakeKey("other", "", "Platform", "Device", "1.0");
+        CHECK(cache.store(key, {'1'}));
+        const std::filesystem::path file = std::filesystem::directory_iterator(directory)->path();
+        CHECK(cache.clear() == 1);
+        CHECK(cache.store(other, {'2'}));
+        std::filesystem::rename(std::filesystem::directory_iterator(directory)->path(), file);
+        CHECK(!cache.load(key));
+
+        std::filesystem::remove_all(directory);
+    }
+}
@@ -0,0 +1,63 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "split.hpp"
+
+TEST_CASE("Range splitting")
+{
+    SECTION("Equal weights")
+    {
+        auto parts = CLTestbench::SplitRange(1024, {1, 1, 1, 1}, 1);
+        REQUIRE(parts.size() == 4);
+        for (std::size_t i = 0; i < parts.size(); ++i) {
+            CHECK(parts[i].mOffset == i * 256);
+            CHECK(parts[i].mSize == 256);
+        }
+    }
+
+    SECTION("Weighted")
+    {
+        auto parts = CLTestbench::SplitRange(1000, {3, 1}, 1);
+        REQUIRE(parts.size() == 2);
+        CHECK(parts[0].mOffset == 0);
+        CHECK(parts[0].mSize == 750);
+        CHECK(parts[1].mOffset == 750);
+        CHECK(parts[1].mSize == 250);
+    }
+
+    SECTION("Granularity")
+    {
+        // Boundaries fall on work-group multiples, and the last part takes the remainder.
+        auto parts = CLTestbench::SplitRange(1000, {1, 1, 1}, 64);
+        REQUIRE(parts.size() == 3);
+        CHECK(parts[0].mSize == 320);
+        CHECK(parts[1].mOffset == 320);
+        CHECK(parts[1].mSize == 320);
+        CHECK(parts[2].mOffset == 640);
+        CHECK(parts[2].mSize == 360);
+    }
+
+    SECTION("Empty parts")
+    {
+        auto parts = CLTestbench::SplitRange(64, {1, 0, 1}, 64);
+        REQUIRE(parts.size() == 3);
+        CHECK(parts[0].mSize == 0);
+        CHECK(parts[1].mSize == 0);
+        CHECK(parts[2].mOffset == 0);
+        CHECK(parts[2].mSize == 64);
+    }
+}
@@ -0,0 +1,61 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "statistics.hpp"
+
+TEST_CASE("Timing statistics")
+{
+    SECTION("Empty")
+    {
+        auto stats = CLTestbench::ComputeStatistics({});
+        CHECK(stats.mMin == 0);
+        CHECK(stats.mMax == 0);
+        CHECK(stats.mMean == 0);
+        CHECK(stats.mStdDev == 0);
+    }
+
+    SECTION("Single sample")
+    {
+        auto stats = CLTestbench::ComputeStatistics({42});
+        CHECK(stats.mMin == 42);
+        CHECK(stats.mMax == 42);
+        CHECK(stats.mMedian == 42);
+        CHECK(stats.mP99 == 42);
+        CHECK(stats.mStdDev == 0);
+    }
+
+    SECTION("Unsorted samples")
+    {
+        auto stats = CLTestbench::ComputeStatistics({5, 1, 4, 2, 3});
+        CHECK(stats.mMin == 1);
+        CHECK(stats.mMax == 5);
+        CHECK(stats.mMean == 3);
+        CHECK(stats.mMedian == 3);
+        // Rank 0.95 * 4 = 3.8, between 4 and 5.
+        CHECK(stats.mP95 > 4.79);
+        CHECK(stats.mP95 < 4.81);
+        // Sample standard deviation of 1..5 is sqrt(2.5).
+        CHECK(stats.mStdDev > 1.581);
+        CHECK(stats.mStdDev < 1.582);
+    }
+
+    SECTION("Even number of samples")
+    {
+        auto stats = CLTestbench::ComputeStatistics({10, 20, 30, 40});
+        CHECK(stats.mMedian == 25);
+    }
+}
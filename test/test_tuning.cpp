@@ -0,0 +1,73 @@
+// This file is part of CLTestbench.
+
+// CLTestbench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CLTestbench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CLTestbench.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <filesystem>
+
+#include "tuning.hpp"
+
+using namespace CLTestbench;
+
+TEST_CASE("Local size tuning")
+{
+    SECTION("Candidates")
+    {
+        Driver::KernelLimits limits;
+        limits.mMaxWorkGroupSize = 256;
+        limits.mPreferredMultiple = 12;
+        limits.mMaxWorkItemSizes = {256, 256, 64};
+
+        auto candidates = LocalSizeCandidates({96, 0, 0}, limits);
+        std::vector<Driver::EnqueueSize> expected{
+            {1, 0, 0}, {2, 0, 0}, {4, 0, 0}, {8, 0, 0}, {12, 0, 0},
+            {16, 0, 0}, {24, 0, 0}, {32, 0, 0}, {48, 0, 0}, {96, 0, 0}};
+        CHECK(candidates == expected);
+
+        candidates = LocalSizeCandidates({64, 64, 0}, limits);
+        CHECK(!candidates.empty());
+        for (const auto& local : candidates) {
+            CHECK(local[0] * local[1] <= limits.mMaxWorkGroupSize);
+            CHECK(local[2] == 0);
+        }
+        CHECK(std::find(candidates.begin(), candidates.end(), Driver::EnqueueSize{16, 16, 0}) != candidates.end());
+
+        limits.mMaxWorkGroupSize = 0;
+        CHECK(LocalSizeCandidates({64, 0, 0}, limits).empty());
+    }
+
+    SECTION("Cache")
+    {
+        const auto file = std::filesystem::temp_directory_path() / "cltb_test_localsizes";
+        std::filesystem::remove(file);
+
+        LocalSizeCache::Key key{"Some Device", "1.0", "kernel", {1024, 16, 0}};
+        {
+            LocalSizeCache cache(file);
+            CHECK(cache.empty());
+            CHECK(!cache.find(key));
+            CHECK(cache.store(key, {64, 4, 0}));
+        }
+
+        LocalSizeCache cache(file);
+        REQUIRE(cache.find(key));
+        CHECK(*cache.find(key) == Driver::EnqueueSize{64, 4, 0});
+        key.mDriverVersion = "2.0";
+        CHECK(!cache.find(key));
+
+        std::filesystem::remove(file);
+    }
+}